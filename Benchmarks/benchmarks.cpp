@@ -0,0 +1,983 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <numbers>
+#include <utility>
+#include <random>
+#include <vector>
+
+#include "bvh.hpp"
+#include "cosine_search.hpp"
+#include "half.hpp"
+#include "half_batch.hpp"
+#include "hnsw.hpp"
+#include "kdtree.hpp"
+#include "pairwise.hpp"
+#include "parallel.hpp"
+#include "quantized_search.hpp"
+#include "spatial_grid.hpp"
+#include "vector.hpp"
+#include "vector_batch.hpp"
+#include "vector_simd.hpp"
+
+// Throughput benchmarks for the library. Run with no arguments for every section, or name
+// the sections to run. Build the Release configuration; Debug numbers mean nothing.
+
+#if defined(_MSC_VER)
+#define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Seconds per call of f, best of five timed batches of calls. Each batch repeats f until
+    // it takes at least 20 ms, so short calls are not lost in the clock resolution.
+    template <typename F>
+    double secondsPerCall(F f)
+    {
+        std::size_t calls = 1;
+        while (true)
+        {
+            Clock::time_point start = Clock::now();
+            for (std::size_t i = 0; i < calls; ++i)
+                f();
+            if (std::chrono::duration<double>(Clock::now() - start).count() >= 0.02)
+                break;
+            calls *= 2;
+        }
+        double best = 0.0;
+        for (int run = 0; run < 5; ++run)
+        {
+            Clock::time_point start = Clock::now();
+            for (std::size_t i = 0; i < calls; ++i)
+                f();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count() / static_cast<double>(calls);
+            best = run == 0 ? seconds : std::min(best, seconds);
+        }
+        return best;
+    }
+
+    // Keeps the optimizer from dropping a computation whose result is otherwise unused.
+    volatile double sink;
+
+    // count vectors with components uniform in [-1, 1).
+    template <typename T, std::size_t N>
+    std::vector<VectorN<T, N>> randomVectors(std::size_t count, unsigned int seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+        std::vector<VectorN<T, N>> vectors(count);
+        for (auto& v : vectors)
+        {
+            for (std::size_t axis = 0; axis < N; ++axis)
+                v[axis] = static_cast<T>(uniform(random));
+        }
+        return vectors;
+    }
+
+    // ---- kernels: every BatchKernels entry at every available instruction set level ----
+
+    // Operands for every kernel signature, n elements per array.
+    struct KernelBuffers
+    {
+        static constexpr std::size_t dims = 16;   // columnDotProductsF32
+        static constexpr std::size_t queries = 4;
+
+        std::size_t n;
+        std::array<std::vector<double>, 6> in;   // x, y, z, then a second vector or w
+        std::array<std::vector<double>, 9> out;  // three vectors or one matrix
+        std::array<double*, 9> matrix;
+        std::array<const double*, 9> constMatrix;
+        std::array<std::vector<float>, 6> floats;
+        std::vector<float> floatOut;
+        std::array<std::vector<std::uint16_t>, 6> halves;
+        std::vector<std::uint8_t> unsignedBytes;
+        std::vector<std::int8_t> signedBytes;
+        std::vector<std::vector<float>> columns;
+        std::vector<const float*> columnPointers;
+        std::vector<float> queryRows;
+        std::vector<float> columnOut;
+
+        explicit KernelBuffers(std::size_t count) : n(count)
+        {
+            std::mt19937 random(5);
+            std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+            for (auto& array : in)
+            {
+                array.resize(n);
+                for (double& value : array)
+                    value = uniform(random);
+            }
+            for (std::size_t e = 0; e < 9; ++e)
+            {
+                out[e].assign(n, 0.0);
+                matrix[e] = out[e].data();
+                constMatrix[e] = out[e].data();
+            }
+            for (auto& array : floats)
+            {
+                array.resize(n);
+                for (float& value : array)
+                    value = static_cast<float>(uniform(random));
+            }
+            floatOut.assign(n, 0.0f);
+            for (auto& array : halves)
+            {
+                array.resize(n);
+                for (std::uint16_t& value : array)
+                    value = floatToHalf(static_cast<float>(uniform(random)));
+            }
+            unsignedBytes.resize(n);
+            signedBytes.resize(n);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                unsignedBytes[i] = static_cast<std::uint8_t>(random());
+                signedBytes[i] = static_cast<std::int8_t>(random());
+            }
+            std::size_t vectors = n / dims;
+            columns.assign(dims, std::vector<float>(vectors, 0.5f));
+            for (const auto& column : columns)
+                columnPointers.push_back(column.data());
+            queryRows.assign(queries * dims, 0.25f);
+            columnOut.assign(queries * vectors, 0.0f);
+        }
+    };
+
+    struct KernelCase
+    {
+        const char* name;
+        double bytesPerElement; // read plus written
+        void (*run)(const BatchKernels& k, KernelBuffers& b);
+    };
+
+    // Operands of the kernels that take parameters.
+    const double affineRows[12] = { 0.8, -0.6, 0.0, 1.0, 0.6, 0.8, 0.0, 2.0, 0.0, 0.0, 1.0, 3.0 };
+    const double axis[3] = { 0.3, 0.4, 0.5 };
+    const double origin[3] = { 0.1, 0.2, 0.3 };
+
+    const KernelCase kernelCases[] = {
+        { "add", 24, [](const BatchKernels& k, KernelBuffers& b) { k.add(b.in[0].data(), b.in[1].data(), b.out[0].data(), b.n); } },
+        { "subtract", 24, [](const BatchKernels& k, KernelBuffers& b) { k.subtract(b.in[0].data(), b.in[1].data(), b.out[0].data(), b.n); } },
+        { "scale", 16, [](const BatchKernels& k, KernelBuffers& b) { k.scale(b.in[0].data(), 1.5, b.out[0].data(), b.n); } },
+        { "axpy", 24, [](const BatchKernels& k, KernelBuffers& b) { k.axpy(1e-9, b.in[0].data(), b.out[0].data(), b.n); } },
+        { "sum", 8, [](const BatchKernels& k, KernelBuffers& b) { sink = k.sum(b.in[0].data(), b.n); } },
+        { "sumCompensated", 8, [](const BatchKernels& k, KernelBuffers& b) { sink = k.sumCompensated(b.in[0].data(), b.n); } },
+        { "minMax", 8, [](const BatchKernels& k, KernelBuffers& b) {
+            double low = b.in[0][0], high = b.in[0][0];
+            k.minMax(b.in[0].data(), b.n, &low, &high);
+            sink = high - low;
+        } },
+        { "moments3", 24, [](const BatchKernels& k, KernelBuffers& b) {
+            double moments[9];
+            k.moments3(origin, b.in[0].data(), b.in[1].data(), b.in[2].data(), b.n, moments);
+            sink = moments[3];
+        } },
+        { "dotProduct3", 56, [](const BatchKernels& k, KernelBuffers& b) {
+            k.dotProduct3(b.in[0].data(), b.in[1].data(), b.in[2].data(), b.in[3].data(), b.in[4].data(), b.in[5].data(), b.out[0].data(), b.n);
+        } },
+        { "crossProduct3", 72, [](const BatchKernels& k, KernelBuffers& b) {
+            k.crossProduct3(b.in[0].data(), b.in[1].data(), b.in[2].data(), b.in[3].data(), b.in[4].data(), b.in[5].data(),
+                            b.out[0].data(), b.out[1].data(), b.out[2].data(), b.n);
+        } },
+        { "magnitude3", 32, [](const BatchKernels& k, KernelBuffers& b) {
+            k.magnitude3(b.in[0].data(), b.in[1].data(), b.in[2].data(), b.out[0].data(), b.n);
+        } },
+        { "distanceSquared3", 32, [](const BatchKernels& k, KernelBuffers& b) {
+            k.distanceSquared3(0.1, 0.2, 0.3, b.in[0].data(), b.in[1].data(), b.in[2].data(), b.out[0].data(), b.n);
+        } },
+        { "normalize3", 48, [](const BatchKernels& k, KernelBuffers& b) {
+            k.normalize3(b.in[0].data(), b.in[1].data(), b.in[2].data(), b.out[0].data(), b.out[1].data(), b.out[2].data(), b.n);
+        } },
+        { "normalize3Fast", 48, [](const BatchKernels& k, KernelBuffers& b) {
+            k.normalize3Fast(b.in[0].data(), b.in[1].data(), b.in[2].data(), b.out[0].data(), b.out[1].data(), b.out[2].data(), b.n);
+        } },
+        { "projectAxis3", 48, [](const BatchKernels& k, KernelBuffers& b) {
+            k.projectAxis3(axis, 1.0, -2.0, b.in[0].data(), b.in[1].data(), b.in[2].data(), b.out[0].data(), b.out[1].data(), b.out[2].data(), b.n);
+        } },
+        { "transform3", 48, [](const BatchKernels& k, KernelBuffers& b) {
+            k.transform3(affineRows, b.in[0].data(), b.in[1].data(), b.in[2].data(), b.out[0].data(), b.out[1].data(), b.out[2].data(), b.n);
+        } },
+        { "quaternionToMatrix3", 104, [](const BatchKernels& k, KernelBuffers& b) {
+            k.quaternionToMatrix3(b.in[0].data(), b.in[1].data(), b.in[2].data(), b.in[3].data(), b.matrix.data(), b.n);
+        } },
+        { "transform3Each", 120, [](const BatchKernels& k, KernelBuffers& b) {
+            // Reads the matrices from out[0..8] and writes over in[3..5].
+            k.transform3Each(b.constMatrix.data(), b.in[0].data(), b.in[1].data(), b.in[2].data(), b.in[3].data(), b.in[4].data(), b.in[5].data(), b.n);
+        } },
+        { "orthonormalBasis3", 96, [](const BatchKernels& k, KernelBuffers& b) {
+            k.orthonormalBasis3(b.in[0].data(), b.in[1].data(), b.in[2].data(), b.matrix.data(), b.n);
+        } },
+        { "orthonormalFrame3", 120, [](const BatchKernels& k, KernelBuffers& b) {
+            k.orthonormalFrame3(b.in[0].data(), b.in[1].data(), b.in[2].data(), b.in[3].data(), b.in[4].data(), b.in[5].data(), b.matrix.data(), b.n);
+        } },
+        { "widenF16", 6, [](const BatchKernels& k, KernelBuffers& b) { k.widenF16(b.halves[0].data(), b.floatOut.data(), b.n); } },
+        { "narrowF16", 6, [](const BatchKernels& k, KernelBuffers& b) { k.narrowF16(b.floats[0].data(), b.halves[5].data(), b.n); } },
+        { "widenBF16", 6, [](const BatchKernels& k, KernelBuffers& b) { k.widenBF16(b.halves[0].data(), b.floatOut.data(), b.n); } },
+        { "narrowBF16", 6, [](const BatchKernels& k, KernelBuffers& b) { k.narrowBF16(b.floats[0].data(), b.halves[5].data(), b.n); } },
+        { "dotProduct3F16", 16, [](const BatchKernels& k, KernelBuffers& b) {
+            k.dotProduct3F16(b.halves[0].data(), b.halves[1].data(), b.halves[2].data(), b.halves[3].data(), b.halves[4].data(), b.halves[5].data(),
+                             b.floatOut.data(), b.n);
+        } },
+        { "dotProduct3BF16", 16, [](const BatchKernels& k, KernelBuffers& b) {
+            k.dotProduct3BF16(b.halves[0].data(), b.halves[1].data(), b.halves[2].data(), b.halves[3].data(), b.halves[4].data(), b.halves[5].data(),
+                              b.floatOut.data(), b.n);
+        } },
+        { "magnitude3F16", 10, [](const BatchKernels& k, KernelBuffers& b) {
+            k.magnitude3F16(b.halves[0].data(), b.halves[1].data(), b.halves[2].data(), b.floatOut.data(), b.n);
+        } },
+        { "magnitude3BF16", 10, [](const BatchKernels& k, KernelBuffers& b) {
+            k.magnitude3BF16(b.halves[0].data(), b.halves[1].data(), b.halves[2].data(), b.floatOut.data(), b.n);
+        } },
+        { "dotProduct3F32", 28, [](const BatchKernels& k, KernelBuffers& b) {
+            k.dotProduct3F32(b.floats[0].data(), b.floats[1].data(), b.floats[2].data(), b.floats[3].data(), b.floats[4].data(), b.floats[5].data(),
+                             b.floatOut.data(), b.n);
+        } },
+        { "dotProductU8I8", 2, [](const BatchKernels& k, KernelBuffers& b) {
+            // In pieces of 65536, the longest the kernel sums exactly.
+            std::int32_t total = 0;
+            for (std::size_t first = 0; first < b.n; first += 65536)
+                total += k.dotProductU8I8(b.unsignedBytes.data() + first, b.signedBytes.data() + first, std::min<std::size_t>(65536, b.n - first));
+            sink = total;
+        } },
+        { "dotProductF32", 8, [](const BatchKernels& k, KernelBuffers& b) { sink = k.dotProductF32(b.floats[0].data(), b.floats[1].data(), b.n); } },
+        { "columnDotProductsF32", 4 + (4.0 * KernelBuffers::queries / KernelBuffers::dims), [](const BatchKernels& k, KernelBuffers& b) {
+            // n floats of columns, dims per vector, scored against four queries.
+            k.columnDotProductsF32(b.columnPointers.data(), b.queryRows.data(), KernelBuffers::queries, KernelBuffers::dims, b.columnOut.data(),
+                                   b.n / KernelBuffers::dims);
+        } },
+    };
+
+    // GB/s of every kernel on every level, once with operands that fit in L1 and once with
+    // operands far larger than the last level cache.
+    void benchmarkKernels()
+    {
+        std::vector<const BatchKernels*> levels;
+        for (int level = 0; level <= static_cast<int>(SimdLevel::AVX512); ++level)
+        {
+            if (const BatchKernels* table = batchKernels(static_cast<SimdLevel>(level)))
+                levels.push_back(table);
+        }
+
+        for (std::size_t n : { std::size_t(1) << 10, std::size_t(1) << 21 })
+        {
+            KernelBuffers buffers(n);
+            std::printf("kernels: GB/s, %zu elements per call (dispatched level: %s)\n", n, simdLevelName(batchKernels().level));
+            std::printf("  %-22s", "kernel");
+            for (const BatchKernels* table : levels)
+                std::printf("%10s", simdLevelName(table->level));
+            std::printf("\n");
+            for (const KernelCase& kernel : kernelCases)
+            {
+                std::printf("  %-22s", kernel.name);
+                for (const BatchKernels* table : levels)
+                {
+                    double seconds = secondsPerCall([&] { kernel.run(*table, buffers); });
+                    std::printf("%10.1f", kernel.bytesPerElement * static_cast<double>(n) / seconds * 1e-9);
+                }
+                std::printf("\n");
+            }
+            std::printf("\n");
+        }
+    }
+
+    // ---- vector3-add: a loop of a million Vector3D adds ----
+
+    // Vector3D addition as it was before vector.hpp went header-only: a call into another
+    // translation unit that returns a temporary, which the loop can neither inline nor
+    // vectorize.
+    BENCHMARK_NOINLINE Vector3D addOutOfLine(const Vector3D& a, const Vector3D& b)
+    {
+        return a + b;
+    }
+
+    // At a million vectors the loop streams 72 MB and runs at memory speed either way; the
+    // thousand-vector loop stays in L1 and shows the cost of the call itself.
+    void benchmarkVector3Add()
+    {
+        for (std::size_t count : { std::size_t(1000), std::size_t(1000000) })
+        {
+            std::vector<Vector3D> a = randomVectors<double, 3>(count, 1);
+            std::vector<Vector3D> b = randomVectors<double, 3>(count, 2);
+            std::vector<Vector3D> out(count);
+
+            double inlined = secondsPerCall([&] {
+                for (std::size_t i = 0; i < count; ++i)
+                    out[i] = a[i] + b[i];
+                sink = out[count / 2].x;
+            });
+            double called = secondsPerCall([&] {
+                for (std::size_t i = 0; i < count; ++i)
+                    out[i] = addOutOfLine(a[i], b[i]);
+                sink = out[count / 2].x;
+            });
+            std::printf("vector3-add: %zu Vector3D adds per loop\n", count);
+            std::printf("  %-22s%10.3f ms%10.2f ns/add\n", "inline operator+", inlined * 1e3, inlined * 1e9 / count);
+            std::printf("  %-22s%10.3f ms%10.2f ns/add\n", "out-of-line call", called * 1e3, called * 1e9 / count);
+            std::printf("  speedup %.2fx\n\n", called / inlined);
+        }
+    }
+
+    // ---- precision: float, double and long double side by side ----
+
+    struct PrecisionResult
+    {
+        double normalizeSeconds;   // per vector
+        double angleSeconds;       // per pair
+        double normalizeError;     // max | |normalize(v)| - 1 |
+        double angleError;         // max error in degrees against long double, on the same inputs
+    };
+
+    // source is rounded to T once; errors are of the T computation on those rounded inputs.
+    template <typename T>
+    PrecisionResult measurePrecision(const std::vector<Vector3D>& a, const std::vector<Vector3D>& b)
+    {
+        std::size_t count = a.size();
+        std::vector<Vector3<T>> x(count), y(count), normalized(count);
+        std::vector<T> angles(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            x[i] = Vector3<T>(a[i]);
+            y[i] = Vector3<T>(b[i]);
+        }
+
+        PrecisionResult result{};
+        result.normalizeSeconds = secondsPerCall([&] {
+            for (std::size_t i = 0; i < count; ++i)
+                normalized[i] = x[i].normalize();
+            sink = static_cast<double>(normalized[count / 2].x);
+        }) / static_cast<double>(count);
+        result.angleSeconds = secondsPerCall([&] {
+            for (std::size_t i = 0; i < count; ++i)
+                angles[i] = x[i].angleBetween(y[i]);
+            sink = static_cast<double>(angles[count / 2]);
+        }) / static_cast<double>(count);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            long double length = Vector3ld(normalized[i]).magnitude();
+            result.normalizeError = std::max(result.normalizeError, static_cast<double>(std::abs(length - 1.0L)));
+            long double reference = Vector3ld(x[i]).angleBetween(Vector3ld(y[i]));
+            result.angleError = std::max(result.angleError, static_cast<double>(std::abs(static_cast<long double>(angles[i]) - reference)));
+        }
+        return result;
+    }
+
+    // long double is the reference for the angle errors, so its own angle error is left out.
+    // Where long double is the same type as double (Visual C++), the two rows match.
+    void benchmarkPrecision()
+    {
+        constexpr std::size_t count = 1 << 20;
+        std::vector<Vector3D> a = randomVectors<double, 3>(count, 3);
+        std::vector<Vector3D> b = randomVectors<double, 3>(count, 4);
+
+        std::printf("precision: normalize and angleBetween over %zu Vector3 pairs (long double is %zu bytes)\n", count, sizeof(long double));
+        std::printf("  %-12s%16s%16s%18s%18s\n", "type", "normalize ns", "angle ns", "normalize error", "angle error deg");
+        auto print = [](const char* name, const PrecisionResult& r, bool reference) {
+            std::printf("  %-12s%16.2f%16.2f%18.2e", name, r.normalizeSeconds * 1e9, r.angleSeconds * 1e9, r.normalizeError);
+            if (reference)
+                std::printf("%18s\n", "(reference)");
+            else
+                std::printf("%18.2e\n", r.angleError);
+        };
+        print("float", measurePrecision<float>(a, b), false);
+        print("double", measurePrecision<double>(a, b), false);
+        print("long double", measurePrecision<long double>(a, b), true);
+        std::printf("\n");
+    }
+
+    // ---- angle: angleBetween against the acos formula it replaced ----
+
+    // The angleBetween of the float/long double change: acos of the clamped cosine.
+    double angleBetweenAcos(const Vector3D& a, const Vector3D& b)
+    {
+        double cosine = a.dotProduct(b) / (a.magnitude() * b.magnitude());
+        return std::acos(std::clamp(cosine, -1.0, 1.0)) * (180.0 / std::numbers::pi);
+    }
+
+    // Pairs of double vectors at angle, or pi - angle when opposite: a random unit vector a
+    // and b = cos(angle) a + sin(angle) p for a unit p perpendicular to a, built in long double.
+    void pairsAtAngle(long double angle, bool opposite, std::size_t count, std::vector<Vector3D>& a, std::vector<Vector3D>& b)
+    {
+        std::vector<Vector3D> directions = randomVectors<double, 3>(2 * count, 6);
+        a.resize(count);
+        b.resize(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Vector3ld u = Vector3ld(directions[2 * i]).normalize();
+            Vector3ld p = u.crossProduct(Vector3ld(directions[(2 * i) + 1])).normalize();
+            Vector3ld v = (u * std::cos(angle)) + (p * std::sin(angle));
+            a[i] = Vector3D(u);
+            b[i] = Vector3D(opposite ? v * -1.0L : v);
+        }
+    }
+
+    void benchmarkAngle()
+    {
+        constexpr std::size_t count = 1 << 20;
+        std::vector<Vector3D> a = randomVectors<double, 3>(count, 7);
+        std::vector<Vector3D> b = randomVectors<double, 3>(count, 8);
+        Vector3DBatch batchA(a), batchB(b);
+        std::vector<double> angles(count);
+
+        double acosSeconds = secondsPerCall([&] {
+            for (std::size_t i = 0; i < count; ++i)
+                angles[i] = angleBetweenAcos(a[i], b[i]);
+            sink = angles[count / 2];
+        });
+        double atan2Seconds = secondsPerCall([&] {
+            for (std::size_t i = 0; i < count; ++i)
+                angles[i] = a[i].angleBetween(b[i]);
+            sink = angles[count / 2];
+        });
+        double radiansSeconds = secondsPerCall([&] {
+            for (std::size_t i = 0; i < count; ++i)
+                angles[i] = a[i].angleBetween(b[i], AngleUnit::Radians);
+            sink = angles[count / 2];
+        });
+        double batchSeconds = secondsPerCall([&] {
+            batchA.angleBetween(batchB, angles.data(), AngleUnit::Radians);
+            sink = angles[count / 2];
+        });
+        std::printf("angle: angleBetween over %zu random Vector3D pairs\n", count);
+        std::printf("  %-38s%10.2f ns/pair\n", "acos of cosine (previous)", acosSeconds * 1e9 / count);
+        std::printf("  %-38s%10.2f ns/pair\n", "atan2 of cross and dot, degrees", atan2Seconds * 1e9 / count);
+        std::printf("  %-38s%10.2f ns/pair\n", "atan2 of cross and dot, radians", radiansSeconds * 1e9 / count);
+        std::printf("  %-38s%10.2f ns/pair\n", "Vector3DBatch::angleBetween, radians", batchSeconds * 1e9 / count);
+
+        // Largest error in degrees against long double atan2 on the same double inputs.
+        constexpr std::size_t pairs = 1 << 14;
+        std::printf("  max error in degrees near the poles, %zu pairs per row\n", pairs);
+        std::printf("  %-24s%16s%16s\n", "angle", "acos", "atan2");
+        for (bool opposite : { false, true })
+        {
+            for (long double angle : { 1e-2L, 1e-4L, 1e-6L, 1e-8L, 1e-10L })
+            {
+                std::vector<Vector3D> x, y;
+                pairsAtAngle(angle, opposite, pairs, x, y);
+                double acosError = 0.0, atan2Error = 0.0;
+                for (std::size_t i = 0; i < pairs; ++i)
+                {
+                    long double reference = Vector3ld(x[i]).angleBetween(Vector3ld(y[i]));
+                    acosError = std::max(acosError, static_cast<double>(std::abs(angleBetweenAcos(x[i], y[i]) - reference)));
+                    atan2Error = std::max(atan2Error, static_cast<double>(std::abs(x[i].angleBetween(y[i]) - reference)));
+                }
+                char label[32];
+                std::snprintf(label, sizeof(label), "%s%.0Le rad", opposite ? "180 deg - " : "", angle);
+                std::printf("  %-24s%16.2e%16.2e\n", label, acosError, atan2Error);
+            }
+        }
+        std::printf("\n");
+    }
+
+    // ---- expressions: expression templates against step-by-step temporaries ----
+
+    // r = (a + b) * s - c and r = (a + b) * s - c + d - e over 10M-element Vector3D batches.
+    // The step-by-step versions reuse two preallocated temporaries, so they pay for the extra
+    // passes over memory but not for allocation.
+    void benchmarkExpressions()
+    {
+        constexpr std::size_t count = 10000000;
+        constexpr double s = 0.5;
+        std::vector<Vector3DBatch> inputs;
+        for (unsigned int seed = 0; seed < 5; ++seed)
+            inputs.emplace_back(randomVectors<double, 3>(count, 10 + seed));
+        const Vector3DBatch &a = inputs[0], &b = inputs[1], &c = inputs[2], &d = inputs[3], &e = inputs[4];
+        Vector3DBatch result(count), first(count), second(count);
+
+        double fused3 = secondsPerCall([&] { result = (a + b) * s - c; });
+        double steps3 = secondsPerCall([&] {
+            a.add(b, first);
+            first.scale(s, second);
+            second.subtract(c, result);
+        });
+        double fused5 = secondsPerCall([&] { result = (a + b) * s - c + d - e; });
+        double steps5 = secondsPerCall([&] {
+            a.add(b, first);
+            first.scale(s, second);
+            second.subtract(c, first);
+            first.add(d, second);
+            second.subtract(e, result);
+        });
+
+        std::printf("expressions: %zu-element Vector3D batches\n", count);
+        std::printf("  %-26s%14s%14s%10s\n", "expression", "fused ms", "steps ms", "speedup");
+        std::printf("  %-26s%14.1f%14.1f%9.2fx\n", "(a + b) * s - c", fused3 * 1e3, steps3 * 1e3, steps3 / fused3);
+        std::printf("  %-26s%14.1f%14.1f%9.2fx\n", "(a + b) * s - c + d - e", fused5 * 1e3, steps5 * 1e3, steps5 / fused5);
+        std::printf("\n");
+    }
+
+    // ---- kdtree: KdTree against brute force over Vector3D ----
+
+    void benchmarkKdTree()
+    {
+        constexpr std::size_t pointCount = 200000;
+        constexpr std::size_t queryCount = 2000;
+        constexpr std::size_t k = 8;
+        std::vector<Vector3D> points = randomVectors<double, 3>(pointCount, 20);
+        std::vector<Vector3D> queries = randomVectors<double, 3>(queryCount, 21);
+        Vector3DBatch pointBatch(points), queryBatch(queries);
+
+        KdTree tree;
+        double buildSeconds = secondsPerCall([&] { tree.build(pointBatch); });
+
+        std::vector<KdTree::Neighbor> found(queryCount * k);
+        double treeSeconds = secondsPerCall([&] { tree.nearestBatch(queryBatch, k, found.data()); });
+
+        // Brute force the way a caller without the index would write it.
+        std::vector<std::size_t> exact(queryCount * k);
+        Clock::time_point start = Clock::now();
+        std::vector<std::pair<double, std::size_t>> scored(pointCount);
+        for (std::size_t q = 0; q < queryCount; ++q)
+        {
+            for (std::size_t i = 0; i < pointCount; ++i)
+                scored[i] = { (points[i] - queries[q]).magnitude(), i };
+            std::partial_sort(scored.begin(), scored.begin() + k, scored.end());
+            for (std::size_t j = 0; j < k; ++j)
+                exact[(q * k) + j] = scored[j].second;
+        }
+        double bruteSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < queryCount * k; ++i)
+            mismatches += found[i].index != exact[i];
+
+        std::printf("kdtree: %zu nearest of %zu queries among %zu points\n", k, queryCount, pointCount);
+        std::printf("  %-30s%12.2f ms\n", "KdTree build", buildSeconds * 1e3);
+        std::printf("  %-30s%12.2f ms%10.2f us/query\n", "KdTree nearestBatch", treeSeconds * 1e3, treeSeconds * 1e6 / queryCount);
+        std::printf("  %-30s%12.2f ms%10.2f us/query\n", "brute force", bruteSeconds * 1e3, bruteSeconds * 1e6 / queryCount);
+        std::printf("  speedup %.0fx, %zu of %zu neighbors differ from brute force\n\n", bruteSeconds / treeSeconds, mismatches, queryCount * k);
+    }
+
+    // ---- pairwise: all-pairs distances, stored and streamed ----
+
+    // The streamed case is 50k x 50k, 2.5G pairs or 20 GB of doubles, far more than could be
+    // stored; its callback only counts the pairs within a radius, so the numbers are the
+    // tiling and the kernels themselves. The stored case is 5k x 5k into a 200 MB matrix.
+    void benchmarkPairwise()
+    {
+        constexpr std::size_t streamedCount = 50000;
+        constexpr std::size_t storedCount = 5000;
+        std::vector<Vector3D> points = randomVectors<double, 3>(streamedCount, 60);
+        Vector3DBatch batch(points);
+        Vector3DBatch storedBatch(std::vector<Vector3D>(points.begin(), points.begin() + storedCount));
+
+        std::vector<double> matrix(storedCount * storedCount);
+        double storedSeconds = secondsPerCall([&] { pairwiseDistanceSquared(storedBatch, storedBatch, matrix.data()); });
+
+        std::atomic<std::size_t> close{ 0 };
+        double streamedSeconds = secondsPerCall([&] {
+            close = 0;
+            pairwiseDistanceSquaredTiles(batch, batch, [&](const PairwiseTile& tile) {
+                std::size_t within = 0;
+                for (std::size_t i = 0; i < tile.rows * tile.cols; ++i)
+                    within += tile.values[i] <= 0.01;
+                close += within;
+            });
+        });
+        sink = static_cast<double>(close.load());
+
+        double storedPairs = static_cast<double>(storedCount) * storedCount;
+        double streamedPairs = static_cast<double>(streamedCount) * streamedCount;
+        std::printf("pairwise: squared distances, %u threads\n", workerThreadCount());
+        std::printf("  %-30s%10.1f ms%10.2f G pairs/s%8.1f GB/s written\n", "5k x 5k stored", storedSeconds * 1e3,
+                    storedPairs / storedSeconds * 1e-9, storedPairs * sizeof(double) / storedSeconds * 1e-9);
+        std::printf("  %-30s%10.1f ms%10.2f G pairs/s\n\n", "50k x 50k streamed", streamedSeconds * 1e3, streamedPairs / streamedSeconds * 1e-9);
+    }
+
+    // ---- hnsw: recall and throughput of HnswIndex over an efSearch sweep ----
+
+    // count vectors of dims floats, back to back. With latentDims 0 they are uniform in
+    // [-1, 1), so every direction matters and neighbors are nearly equidistant. Otherwise they
+    // are Gaussian in a random latentDims-dimensional subspace plus a little noise, closer to
+    // real embeddings, whose intrinsic dimension is far below their size.
+    std::vector<float> embeddings(std::size_t count, std::size_t dims, std::size_t latentDims, unsigned int seed)
+    {
+        std::mt19937 basisRandom(29), random(seed);
+        std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::vector<float> basis(latentDims * dims);
+        for (float& value : basis)
+            value = normal(basisRandom);
+        std::vector<float> vectors(count * dims);
+        std::vector<float> latent(latentDims);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            float* v = vectors.data() + (i * dims);
+            if (latentDims == 0)
+            {
+                for (std::size_t d = 0; d < dims; ++d)
+                    v[d] = uniform(random);
+                continue;
+            }
+            for (float& value : latent)
+                value = normal(random);
+            for (std::size_t d = 0; d < dims; ++d)
+            {
+                v[d] = 0.1f * normal(random);
+                for (std::size_t l = 0; l < latentDims; ++l)
+                    v[d] += latent[l] * basis[(l * dims) + d];
+            }
+        }
+        return vectors;
+    }
+
+    void benchmarkHnsw()
+    {
+        constexpr std::size_t count = 20000;
+        constexpr std::size_t dims = 128;
+        constexpr std::size_t queryCount = 1000;
+        constexpr std::size_t k = 10;
+
+        for (std::size_t latentDims : { std::size_t(0), std::size_t(12) })
+        {
+            std::vector<float> vectors = embeddings(count, dims, latentDims, 30);
+            std::vector<float> queries = embeddings(queryCount, dims, latentDims, 31);
+            HnswIndex index(dims, count);
+            Clock::time_point start = Clock::now();
+            index.addBatch(vectors.data(), count);
+            double buildSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+            std::printf("hnsw: %zu vectors of %zu dims, %s, M %zu, efConstruction %zu, built in %.2f s on %u threads\n", count, dims,
+                        latentDims == 0 ? "uniform" : "12-dim latent", index.parameters().M, index.parameters().efConstruction,
+                        buildSeconds, workerThreadCount());
+            std::printf("  %-8s%12s%14s%14s%10s\n", "ef", "recall@10", "queries/s", "brute q/s", "speedup");
+            for (std::size_t ef : { 10, 16, 32, 64, 128, 256, 512 })
+            {
+                index.setEfSearch(ef);
+                HnswReport report = evaluateRecall(index, queries.data(), queryCount, k);
+                std::printf("  %-8zu%12.3f%14.0f%14.0f%9.1fx\n", ef, report.recall, report.queriesPerSecond, report.bruteForceQueriesPerSecond,
+                            report.queriesPerSecond / report.bruteForceQueriesPerSecond);
+            }
+            std::printf("\n");
+        }
+    }
+
+    // ---- cosine: CosineSearch scan bandwidth ----
+
+    // The scan is bound by reading the stored vectors, so its figure of merit is the bytes of
+    // stored vectors scored per second, next to a plain streaming dot product over as many
+    // bytes. searchBatch streams the store once per group of 64 queries, so its rate per
+    // query can pass the memory bandwidth.
+    void benchmarkCosine()
+    {
+        constexpr std::size_t count = 200000;
+        constexpr std::size_t dims = 128;
+        constexpr std::size_t k = 10;
+        std::vector<float> vectors = embeddings(count, dims, 0, 60);
+        std::vector<float> queries = embeddings(256, dims, 0, 61);
+        CosineSearch search(dims);
+        search.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+            search.add(vectors.data() + (i * dims));
+
+        double storeBytes = static_cast<double>(count * dims * sizeof(float));
+        const BatchKernels& kernels = batchKernels();
+        double streamSeconds = secondsPerCall([&] { sink = kernels.dotProductF32(vectors.data(), vectors.data() + (vectors.size() / 2), vectors.size() / 2); });
+
+        std::printf("cosine: %zu vectors of %zu dims (%.0f MB), top %zu, %u threads, %s\n", count, dims, storeBytes / 1e6, k,
+                    workerThreadCount(), simdLevelName(kernels.level));
+        std::printf("  %-28s%12s%14s%16s\n", "", "ms/call", "queries/s", "GB/s of store");
+        std::printf("  %-28s%12.2f%14s%16.1f\n", "dotProductF32 stream", streamSeconds * 1e3, "", storeBytes / streamSeconds / 1e9);
+        std::vector<CosineSearch::Result> results;
+        double searchSeconds = secondsPerCall([&] { search.search(queries.data(), k, results); });
+        std::printf("  %-28s%12.2f%14.0f%16.1f\n", "search", searchSeconds * 1e3, 1.0 / searchSeconds, storeBytes / searchSeconds / 1e9);
+        for (std::size_t queryCount : { std::size_t(16), std::size_t(64), std::size_t(256) })
+        {
+            results.resize(queryCount * k);
+            double seconds = secondsPerCall([&] { search.searchBatch(queries.data(), queryCount, k, results.data()); });
+            char name[32];
+            std::snprintf(name, sizeof(name), "searchBatch of %zu", queryCount);
+            std::printf("  %-28s%12.2f%14.0f%16.1f\n", name, seconds * 1e3, static_cast<double>(queryCount) / seconds,
+                        storeBytes * static_cast<double>(queryCount) / seconds / 1e9);
+        }
+        std::printf("\n");
+    }
+
+    // ---- quantized: QuantizedSearch memory, scan speed and recall against CosineSearch ----
+
+    void benchmarkQuantized()
+    {
+        constexpr std::size_t count = 200000;
+        constexpr std::size_t dims = 128;
+        constexpr std::size_t queryCount = 200;
+        constexpr std::size_t k = 10;
+
+        for (std::size_t latentDims : { std::size_t(0), std::size_t(24) })
+        {
+            std::vector<float> vectors = embeddings(count, dims, latentDims, 70);
+            std::vector<float> queries = embeddings(queryCount, dims, latentDims, 71);
+            CosineSearch exact(dims);
+            exact.reserve(count);
+            for (std::size_t i = 0; i < count; ++i)
+                exact.add(vectors.data() + (i * dims));
+            std::vector<CosineSearch::Result> truth(queryCount * k);
+            double exactSeconds = secondsPerCall([&] { exact.searchBatch(queries.data(), queryCount, k, truth.data()); });
+
+            std::printf("quantized: %zu vectors of %zu dims, %s, top %zu of %zu queries, %u threads\n", count, dims,
+                        latentDims == 0 ? "uniform" : "24-dim latent", k, queryCount, workerThreadCount());
+            // GB/s counts the bytes a scan streams per query: the stored floats, or the codes and
+            // their per-vector terms (the half precision copies are only read for candidates).
+            std::printf("  %-38s%10s%12s%14s%14s%12s\n", "", "B/vector", "1 query ms", "GB/s scanned", "batch q/s", "recall@10");
+            auto row = [&](const char* name, std::size_t bytesPerVector, std::size_t scannedPerVector, double searchSeconds,
+                           double batchSeconds, double recall) {
+                std::printf("  %-38s%10zu%12.2f%14.1f%14.0f%12.3f\n", name, bytesPerVector, searchSeconds * 1e3,
+                            static_cast<double>(scannedPerVector * count) / searchSeconds / 1e9, static_cast<double>(queryCount) / batchSeconds,
+                            recall);
+            };
+            std::vector<CosineSearch::Result> exactSingle;
+            double exactSearchSeconds = secondsPerCall([&] { exact.search(queries.data(), k, exactSingle); });
+            row("CosineSearch (float)", dims * sizeof(float), dims * sizeof(float), exactSearchSeconds, exactSeconds, 1.0);
+
+            for (QuantizationMode mode : { QuantizationMode::PerVector, QuantizationMode::PerDimension })
+            {
+                for (bool keepVectors : { false, true })
+                {
+                    QuantizedSearch search(dims, mode, keepVectors);
+                    if (mode == QuantizationMode::PerDimension)
+                        search.train(vectors.data(), count);
+                    search.reserve(count);
+                    for (std::size_t i = 0; i < count; ++i)
+                        search.add(vectors.data() + (i * dims));
+
+                    std::size_t rerank = keepVectors ? 4 : 0;
+                    std::vector<QuantizedSearch::Result> found(queryCount * k), single;
+                    double searchSeconds = secondsPerCall([&] { search.search(queries.data(), k, single, rerank); });
+                    double seconds = secondsPerCall([&] { search.searchBatch(queries.data(), queryCount, k, found.data(), rerank); });
+                    std::size_t hits = 0;
+                    for (std::size_t q = 0; q < queryCount; ++q)
+                    {
+                        for (std::size_t i = 0; i < k; ++i)
+                        {
+                            for (std::size_t j = 0; j < k; ++j)
+                                hits += found[(q * k) + i].id == truth[(q * k) + j].id;
+                        }
+                    }
+                    char name[64];
+                    std::snprintf(name, sizeof(name), "%s, %s", mode == QuantizationMode::PerVector ? "per vector" : "per dimension",
+                                  keepVectors ? "fp16 copies, rerank 4" : "scan only");
+                    std::size_t scanned = search.bytesPerVector() - (keepVectors ? dims * sizeof(std::uint16_t) : 0);
+                    row(name, search.bytesPerVector(), scanned, searchSeconds, seconds, static_cast<double>(hits) / (queryCount * k));
+                }
+            }
+            std::printf("\n");
+        }
+    }
+
+    // ---- half: measureHalfPrecision for fp16 and bf16 storage ----
+
+    // 8M pairs of Gaussian 3D vectors, 192 MB of float operands, far past the caches.
+    void benchmarkHalf()
+    {
+        constexpr std::size_t count = 8 << 20;
+        std::mt19937 random(50);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        Vector3fBatch a(count), b(count);
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                a.component(axis)[i] = normal(random);
+                b.component(axis)[i] = normal(random);
+            }
+        }
+
+        std::printf("half: %zu pairs of 3D vectors, dotProduct at %s\n", count, simdLevelName(batchKernels().level));
+        std::printf("  %-10s%10s%12s%12s%14s%14s%14s\n", "format", "bytes", "Melem/s", "GB/s", "dot max err", "mag max err", "angle max deg");
+        auto print = [](const char* name, std::size_t bytes, double elementsPerSecond, const HalfPrecisionReport* report) {
+            std::printf("  %-10s%10zu%12.0f%12.1f", name, bytes, elementsPerSecond / 1e6, elementsPerSecond * static_cast<double>(bytes + 4) / 1e9);
+            if (report != nullptr)
+                std::printf("%14.2e%14.2e%14.3f", report->dotProduct.max, report->magnitude.max, report->angleBetween.max);
+            std::printf("\n");
+        };
+        HalfPrecisionReport f16 = measureHalfPrecision<HalfFormat::Float16>(a, b);
+        HalfPrecisionReport bf16 = measureHalfPrecision<HalfFormat::BFloat16>(a, b);
+        print("float", f16.floatBytesPerElement, std::max(f16.floatElementsPerSecond, bf16.floatElementsPerSecond), nullptr);
+        print("fp16", f16.halfBytesPerElement, f16.halfElementsPerSecond, &f16);
+        print("bf16", bf16.halfBytesPerElement, bf16.halfElementsPerSecond, &bf16);
+        std::printf("\n");
+    }
+
+    // ---- grid: SpatialGrid rebuild and radius queries ----
+
+    // 2M points uniform in a 100^3 box with unit cells, about two points per cell, as for a
+    // per-frame rebuild of a particle system.
+    void benchmarkGrid()
+    {
+        constexpr std::size_t count = 2000000;
+        constexpr std::size_t queryCount = 100000;
+        std::vector<Vector3D> points = randomVectors<double, 3>(count, 40);
+        for (Vector3D& p : points)
+            p = (p + Vector3D(1.0, 1.0, 1.0)) * 50.0;
+        Vector3DBatch batch(points);
+
+        SpatialGrid3D grid;
+        double buildSeconds = secondsPerCall([&] { grid.build(batch, 1.0); });
+        std::vector<std::size_t> found;
+        double querySeconds = secondsPerCall([&] {
+            for (std::size_t q = 0; q < queryCount; ++q)
+            {
+                found.clear();
+                grid.withinRadius(points[q], 1.0, found);
+            }
+        });
+        std::printf("grid: %zu points, unit cells, %u threads\n", count, workerThreadCount());
+        std::printf("  %-22s%12.1f ms\n", "build", buildSeconds * 1e3);
+        std::printf("  %-22s%12.0f ns/query\n\n", "withinRadius 1.0", querySeconds * 1e9 / queryCount);
+    }
+
+    // ---- bvh: Bvh query latency, and refit against rebuild as the geometry drifts ----
+
+    struct BvhQueryTimes
+    {
+        double closest, box, ray;
+    };
+
+    BvhQueryTimes timeBvhQueries(const Bvh& bvh, const std::vector<Vector3D>& queries, const std::vector<Vector3D>& directions)
+    {
+        BvhQueryTimes times{};
+        double perQuery = 1.0 / static_cast<double>(queries.size());
+        times.closest = perQuery * secondsPerCall([&] {
+            Bvh::ClosestHit hit{};
+            for (const Vector3D& query : queries)
+                bvh.closestPoint(query, hit);
+            sink = hit.distanceSquared;
+        });
+        std::vector<std::size_t> found;
+        times.box = perQuery * secondsPerCall([&] {
+            for (const Vector3D& query : queries)
+            {
+                found.clear();
+                bvh.queryBox(Box3D(query - Vector3D(1.0, 1.0, 1.0), query + Vector3D(1.0, 1.0, 1.0)), found);
+            }
+            sink = static_cast<double>(found.size());
+        });
+        times.ray = perQuery * secondsPerCall([&] {
+            Bvh::RayHit hit{};
+            for (std::size_t q = 0; q < queries.size(); ++q)
+                bvh.intersectRay(queries[q], directions[q], 20.0, hit);
+            sink = hit.t;
+        });
+        return times;
+    }
+
+    // 100k points and 100k short segments in a 100^3 box, every primitive moving up to 0.5 per
+    // axis each frame. Refit keeps the tree from the first frame, so its boxes overlap more and
+    // more; the columns show what that costs the queries against rebuilding each frame.
+    void benchmarkBvh()
+    {
+        constexpr std::size_t count = 100000;
+        constexpr std::size_t queryCount = 20000;
+        constexpr double radius = 0.1;
+        std::vector<Vector3D> points = randomVectors<double, 3>(count, 50);
+        std::vector<Vector3D> starts = randomVectors<double, 3>(count, 51);
+        std::vector<Vector3D> offsets = randomVectors<double, 3>(count, 52);
+        std::vector<Vector3D> queries = randomVectors<double, 3>(queryCount, 53);
+        std::vector<Vector3D> directions = randomVectors<double, 3>(queryCount, 54);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            points[i] = points[i] * 50.0;
+            starts[i] = starts[i] * 50.0;
+        }
+        for (Vector3D& query : queries)
+            query = query * 50.0;
+        auto ends = [&] {
+            std::vector<Vector3D> result(count);
+            for (std::size_t i = 0; i < count; ++i)
+                result[i] = starts[i] + offsets[i];
+            return Vector3DBatch(result);
+        };
+        Vector3DBatch pointBatch(points), startBatch(starts), endBatch = ends();
+
+        Bvh refitted, rebuilt;
+        double buildSeconds = secondsPerCall([&] { rebuilt.build(pointBatch, startBatch, endBatch, radius); });
+        refitted.build(pointBatch, startBatch, endBatch, radius);
+        double refitSeconds = secondsPerCall([&] { refitted.refit(pointBatch, startBatch, endBatch); });
+
+        std::printf("bvh: %zu points and %zu segments of radius %.1f, %zu queries\n", count, count, radius, queryCount);
+        std::printf("  %-22s%12.2f ms\n", "build", buildSeconds * 1e3);
+        std::printf("  %-22s%12.2f ms\n", "refit", refitSeconds * 1e3);
+        std::printf("  %-8s%-10s%12s%12s%12s  (ns/query)\n", "frame", "tree", "closest", "box 2^3", "ray 20");
+
+        std::vector<Vector3D> steps = randomVectors<double, 3>(2 * count, 55);
+        for (int frame = 0; frame <= 32; ++frame)
+        {
+            if (frame > 0)
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    points[i] = points[i] + (steps[(i + frame * 7919) % (2 * count)] * 0.5);
+                    starts[i] = starts[i] + (steps[(i + count + frame * 7919) % (2 * count)] * 0.5);
+                }
+                pointBatch = Vector3DBatch(points);
+                startBatch = Vector3DBatch(starts);
+                endBatch = ends();
+                refitted.refit(pointBatch, startBatch, endBatch);
+                rebuilt.build(pointBatch, startBatch, endBatch, radius);
+            }
+            if (frame != 0 && frame != 1 && frame != 4 && frame != 16 && frame != 32)
+                continue;
+            for (const Bvh* bvh : { &refitted, &rebuilt })
+            {
+                BvhQueryTimes times = timeBvhQueries(*bvh, queries, directions);
+                std::printf("  %-8d%-10s%12.0f%12.0f%12.0f\n", frame, bvh == &refitted ? "refit" : "rebuild", times.closest * 1e9, times.box * 1e9,
+                            times.ray * 1e9);
+            }
+        }
+        std::printf("\n");
+    }
+
+    struct Section
+    {
+        const char* name;
+        const char* description;
+        void (*run)();
+    };
+
+    const Section sections[] = {
+        { "kernels", "GB/s of every SIMD kernel at every instruction set level", &benchmarkKernels },
+        { "vector3-add", "a million Vector3D adds, inline against an out-of-line call", &benchmarkVector3Add },
+        { "precision", "float, double and long double throughput and error", &benchmarkPrecision },
+        { "angle", "angleBetween against the acos formula, speed and accuracy near 0 and 180 degrees", &benchmarkAngle },
+        { "expressions", "3- and 5-term batch expressions, fused against temporaries", &benchmarkExpressions },
+        { "kdtree", "KdTree kNN against brute force over Vector3D", &benchmarkKdTree },
+        { "pairwise", "all-pairs squared distances, 5k x 5k stored and 50k x 50k streamed", &benchmarkPairwise },
+        { "hnsw", "HnswIndex recall@10 and queries per second over an efSearch sweep", &benchmarkHnsw },
+        { "cosine", "CosineSearch search and searchBatch, bytes of stored vectors scored per second", &benchmarkCosine },
+        { "quantized", "QuantizedSearch bytes per vector, queries per second and recall against CosineSearch", &benchmarkQuantized },
+        { "half", "fp16 and bf16 storage against float: dotProduct throughput and error", &benchmarkHalf },
+        { "grid", "SpatialGrid rebuild of 2M points and radius queries", &benchmarkGrid },
+        { "bvh", "Bvh build, refit and query latency, refitting against rebuilding as primitives drift", &benchmarkBvh },
+    };
+}
+
+int main(int argc, char** argv)
+{
+    bool ranAny = false;
+    for (const Section& section : sections)
+    {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i)
+            selected = selected || std::strcmp(argv[i], section.name) == 0;
+        if (!selected)
+            continue;
+        section.run();
+        ranAny = true;
+    }
+    if (!ranAny)
+    {
+        std::printf("usage: %s [section...]\n", argv[0]);
+        for (const Section& section : sections)
+            std::printf("  %-12s %s\n", section.name, section.description);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+#include "arena.hpp"
+
+namespace
+{
+    // Alignment of chunks from the upstream resource; smaller requests never need padding at
+    // the start of a chunk.
+    constexpr std::size_t chunkAlignment = alignof(std::max_align_t);
+}
+
+Arena::Arena(std::size_t initialSize, std::pmr::memory_resource* upstream)
+    : upstream(upstream), nextChunkSize(std::max<std::size_t>(initialSize, 1))
+{
+}
+
+Arena::~Arena()
+{
+    release();
+}
+
+void Arena::addChunk(std::size_t size)
+{
+    chunks.push_back({ static_cast<std::byte*>(upstream->allocate(size, chunkAlignment)), size });
+    statistics.bytesReserved += size;
+    ++statistics.upstreamAllocations;
+    nextChunkSize = std::max(nextChunkSize, size * 2);
+}
+
+void* Arena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    bytes = std::max<std::size_t>(bytes, 1);
+    // Later chunks are free space left from before a rewind; the first one that fits wins.
+    for (; current < chunks.size(); ++current, offset = 0)
+    {
+        const Chunk& chunk = chunks[current];
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(chunk.data) + offset;
+        std::size_t start = offset + ((alignment - (address & (alignment - 1))) & (alignment - 1));
+        if (start <= chunk.size && bytes <= chunk.size - start)
+        {
+            statistics.bytesInUse += (start - offset) + bytes;
+            statistics.highWaterMark = std::max(statistics.highWaterMark, statistics.bytesInUse);
+            offset = start + bytes;
+            return chunk.data + start;
+        }
+    }
+
+    addChunk(std::max(nextChunkSize, bytes + std::max(alignment, chunkAlignment)));
+    current = chunks.size() - 1;
+    offset = 0;
+    return do_allocate(bytes, alignment);
+}
+
+void Arena::rewind(const Marker& marker)
+{
+    assert(marker.chunk < chunks.size() || (marker.chunk == 0 && marker.offset == 0));
+    assert(marker.bytesInUse <= statistics.bytesInUse);
+    current = marker.chunk;
+    offset = marker.offset;
+    statistics.bytesInUse = marker.bytesInUse;
+}
+
+void Arena::reset()
+{
+    // A cycle that spilled into several chunks gets one chunk of their total size instead,
+    // so the next cycle fits without leaving it.
+    if (chunks.size() > 1)
+    {
+        std::size_t total = statistics.bytesReserved;
+        release();
+        addChunk(total);
+    }
+    current = 0;
+    offset = 0;
+    statistics.bytesInUse = 0;
+    ++statistics.resets;
+}
+
+void Arena::release()
+{
+    for (const Chunk& chunk : chunks)
+        upstream->deallocate(chunk.data, chunk.size, chunkAlignment);
+    chunks.clear();
+    current = 0;
+    offset = 0;
+    statistics.bytesInUse = 0;
+    statistics.bytesReserved = 0;
+}
+
+Arena& threadArena()
+{
+    thread_local Arena arena;
+    return arena;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// What an Arena has handed out and holds. Byte counts include alignment padding.
+struct ArenaStats
+{
+    std::size_t bytesInUse = 0;          // allocated since the last reset
+    std::size_t highWaterMark = 0;       // the most bytesInUse has ever been
+    std::size_t bytesReserved = 0;       // held from the upstream resource
+    std::size_t upstreamAllocations = 0; // chunks ever taken from the upstream resource
+    std::size_t resets = 0;
+};
+
+// Monotonic allocator for temporaries: allocation bumps a pointer through chunks taken from
+// an upstream resource, deallocation does nothing, and reset() makes all of it free again at
+// once. After a reset the chunks are kept (merged into one if a cycle needed several), so a
+// workload that repeats the same allocations between resets stops allocating from upstream
+// after its first cycle. Plugs into std::pmr containers, and into VectorBatch through its
+// resource constructors. Not thread safe; each thread has its own threadArena().
+class Arena : public std::pmr::memory_resource
+{
+public:
+    static constexpr std::size_t defaultChunkSize = 64 * 1024;
+
+    // A position to rewind to, from mark().
+    struct Marker
+    {
+        std::size_t chunk = 0;
+        std::size_t offset = 0;
+        std::size_t bytesInUse = 0;
+    };
+
+    explicit Arena(std::size_t initialSize = defaultChunkSize, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Frees everything allocated since mark() returned marker, which must be newer than the
+    // last reset(). Nested scratch space uses this through ArenaScope.
+    Marker mark() const { return { current, offset, statistics.bytesInUse }; }
+    void rewind(const Marker& marker);
+
+    // Frees everything allocated so far, typically once per request. Anything still
+    // pointing into the arena dangles afterwards.
+    void reset();
+
+    // reset() and returns every chunk to the upstream resource.
+    void release();
+
+    const ArenaStats& stats() const { return statistics; }
+
+private:
+    struct Chunk
+    {
+        std::byte* data;
+        std::size_t size;
+    };
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    void addChunk(std::size_t size);
+
+    std::pmr::memory_resource* upstream;
+    std::vector<Chunk> chunks;
+    std::size_t current = 0; // chunk being allocated from
+    std::size_t offset = 0;  // first free byte in it
+    std::size_t nextChunkSize;
+    ArenaStats statistics;
+};
+
+// The calling thread's arena, created on first use and freed when the thread exits.
+Arena& threadArena();
+
+// Frees, on destruction, everything allocated from an arena during the scope's lifetime.
+// Library functions take their scratch space from threadArena() this way, so they leave it
+// as they found it and can run inside a caller's own arena cycle.
+class ArenaScope
+{
+public:
+    explicit ArenaScope(Arena& arena = threadArena()) : scoped(arena), marker(arena.mark()) {}
+    ~ArenaScope() { scoped.rewind(marker); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    Arena& arena() const { return scoped; }
+
+private:
+    Arena& scoped;
+    Arena::Marker marker;
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+
+// Expression templates for VectorBatch. An expression such as (a + b) * s - c builds a
+// small tree of these nodes instead of evaluating anything; assigning it to a VectorBatch
+// then runs one fused loop per component with no intermediate batches.
+//
+// Every node is component-wise: element i of the result only reads element i of the same
+// component of its operands, so assigning an expression to one of its own operands is safe.
+
+template <typename T, std::size_t N>
+class VectorBatch;
+
+// CRTP base of every expression node, and of VectorBatch itself.
+template <typename E>
+struct BatchExpression
+{
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+// Batches are held by reference, nodes by value (they are tiny and usually temporaries).
+template <typename E>
+struct BatchOperandStorage
+{
+    using type = const E;
+};
+
+template <typename T, std::size_t N>
+struct BatchOperandStorage<VectorBatch<T, N>>
+{
+    using type = const VectorBatch<T, N>&;
+};
+
+struct BatchAddOp
+{
+    template <typename T>
+    static T apply(T a, T b) { return a + b; }
+};
+
+struct BatchSubtractOp
+{
+    template <typename T>
+    static T apply(T a, T b) { return a - b; }
+};
+
+template <typename L, typename R, typename Op>
+class BatchBinaryExpression : public BatchExpression<BatchBinaryExpression<L, R, Op>>
+{
+public:
+    using value_type = typename L::value_type;
+    static constexpr std::size_t dimension = L::dimension;
+
+    BatchBinaryExpression(const L& left, const R& right) : left(left), right(right)
+    {
+        assert(left.size() == right.size());
+    }
+
+    std::size_t size() const { return left.size(); }
+
+    value_type value(std::size_t axis, std::size_t i) const
+    {
+        return Op::apply(left.value(axis, i), right.value(axis, i));
+    }
+
+private:
+    typename BatchOperandStorage<L>::type left;
+    typename BatchOperandStorage<R>::type right;
+};
+
+template <typename E>
+class BatchScaledExpression : public BatchExpression<BatchScaledExpression<E>>
+{
+public:
+    using value_type = typename E::value_type;
+    static constexpr std::size_t dimension = E::dimension;
+
+    BatchScaledExpression(const E& expression, value_type scalar) : expression(expression), scalar(scalar) {}
+
+    std::size_t size() const { return expression.size(); }
+
+    value_type value(std::size_t axis, std::size_t i) const
+    {
+        return scalar * expression.value(axis, i);
+    }
+
+private:
+    typename BatchOperandStorage<E>::type expression;
+    value_type scalar;
+};
+
+template <typename L, typename R>
+concept CompatibleBatchExpressions = std::is_same_v<typename L::value_type, typename R::value_type> && L::dimension == R::dimension;
+
+template <typename L, typename R>
+    requires CompatibleBatchExpressions<L, R>
+BatchBinaryExpression<L, R, BatchAddOp> operator+(const BatchExpression<L>& left, const BatchExpression<R>& right)
+{
+    return BatchBinaryExpression<L, R, BatchAddOp>(left.self(), right.self());
+}
+
+template <typename L, typename R>
+    requires CompatibleBatchExpressions<L, R>
+BatchBinaryExpression<L, R, BatchSubtractOp> operator-(const BatchExpression<L>& left, const BatchExpression<R>& right)
+{
+    return BatchBinaryExpression<L, R, BatchSubtractOp>(left.self(), right.self());
+}
+
+template <typename E>
+BatchScaledExpression<E> operator*(const BatchExpression<E>& expression, std::type_identity_t<typename E::value_type> scalar)
+{
+    return BatchScaledExpression<E>(expression.self(), scalar);
+}
+
+template <typename E>
+BatchScaledExpression<E> operator*(std::type_identity_t<typename E::value_type> scalar, const BatchExpression<E>& expression)
+{
+    return BatchScaledExpression<E>(expression.self(), scalar);
+}
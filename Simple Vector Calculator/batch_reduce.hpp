@@ -0,0 +1,234 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <type_traits>
+
+#include "arena.hpp"
+#include "bounding_box.hpp"
+#include "parallel.hpp"
+#include "vector.hpp"
+#include "vector_batch.hpp"
+#include "vector_simd.hpp"
+
+// Parallel reductions over a VectorBatch.
+//
+// The batch is cut into fixed chunks of reductionChunkSize elements. The chunks reduce to
+// one partial each on the worker threads and the partials are combined in chunk order, so
+// a result does not depend on the thread count or on scheduling. Within a chunk, double
+// batches use the SIMD kernels, which add in a different order than a plain loop.
+// The partials and per-chunk scratch buffers live in threadArena() scratch space (arena.hpp),
+// so repeated reductions do not allocate from the heap.
+
+inline constexpr std::size_t reductionChunkSize = 1 << 14;
+
+// How sums are accumulated.
+//   Fast           plain SIMD adds. Repeatable on one machine, but the rounding depends on
+//                  the instruction set, and the error grows with the element count.
+//   Deterministic  compensated sums over fixed blocks of 4096 elements, then a compensated
+//                  sum of the block sums, so the reduction tree depends only on the element
+//                  count. The same bits for any thread count and instruction set, and the
+//                  error does not grow with the element count.
+enum class ReductionMode
+{
+    Fast,
+    Deterministic
+};
+
+// Compensated sum: the SIMD kernel for doubles, Neumaier's loop otherwise.
+template <typename T>
+T compensatedSum(const T* values, std::size_t count)
+{
+    if constexpr (std::is_same_v<T, double>)
+    {
+        return batchKernels().sumCompensated(values, count);
+    }
+    else
+    {
+        T sum = T(0);
+        T compensation = T(0);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            T t = sum + values[i];
+            compensation += std::abs(sum) >= std::abs(values[i]) ? (sum - t) + values[i] : (values[i] - t) + sum;
+            sum = t;
+        }
+        return sum + compensation;
+    }
+}
+
+// Smallest and largest element magnitude and where they are. Ties go to the lowest index;
+// both indices are npos for an empty batch.
+template <typename T>
+struct MagnitudeExtremes
+{
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    std::size_t minIndex = npos;
+    std::size_t maxIndex = npos;
+    T minMagnitude = T(0);
+    T maxMagnitude = T(0);
+};
+
+template <typename T, std::size_t N>
+VectorN<T, N> sum(const VectorBatch<T, N>& batch, ReductionMode mode = ReductionMode::Fast)
+{
+    if (mode == ReductionMode::Deterministic)
+    {
+        constexpr std::size_t blockSize = 4096;
+        std::size_t blocks = (batch.size() + blockSize - 1) / blockSize;
+        ArenaScope scratch;
+        std::pmr::vector<T> blockSums(N * blocks, &scratch.arena());
+        parallelFor(blocks, reductionChunkSize / blockSize, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t block = begin; block < end; ++block)
+            {
+                std::size_t first = block * blockSize;
+                std::size_t count = std::min(blockSize, batch.size() - first);
+                for (std::size_t axis = 0; axis < N; ++axis)
+                    blockSums[(axis * blocks) + block] = compensatedSum(batch.component(axis) + first, count);
+            }
+        });
+
+        VectorN<T, N> result;
+        for (std::size_t axis = 0; axis < N; ++axis)
+            result[axis] = compensatedSum(blockSums.data() + (axis * blocks), blocks);
+        return result;
+    }
+
+    ArenaScope scratch;
+    std::pmr::vector<VectorN<T, N>> partials((batch.size() + reductionChunkSize - 1) / reductionChunkSize, &scratch.arena());
+    parallelFor(batch.size(), reductionChunkSize, [&](std::size_t begin, std::size_t end) {
+        VectorN<T, N>& partial = partials[begin / reductionChunkSize];
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            const T* values = batch.component(axis) + begin;
+            if constexpr (VectorBatch<T, N>::hasSimdKernels)
+            {
+                partial[axis] = batchKernels().sum(values, end - begin);
+            }
+            else
+            {
+                for (std::size_t i = 0; i < end - begin; ++i)
+                    partial[axis] += values[i];
+            }
+        }
+    });
+
+    VectorN<T, N> result;
+    for (const VectorN<T, N>& partial : partials)
+        result += partial;
+    return result;
+}
+
+// Mean of the elements; the zero vector for an empty batch.
+template <typename T, std::size_t N>
+VectorN<T, N> centroid(const VectorBatch<T, N>& batch, ReductionMode mode = ReductionMode::Fast)
+{
+    if (batch.empty())
+        return VectorN<T, N>();
+    return sum(batch, mode) * (T(1) / static_cast<T>(batch.size()));
+}
+
+// Smallest box holding every element; empty for an empty batch.
+template <typename T, std::size_t N>
+BoundingBox<T, N> boundingBox(const VectorBatch<T, N>& batch)
+{
+    ArenaScope scratch;
+    std::pmr::vector<BoundingBox<T, N>> partials((batch.size() + reductionChunkSize - 1) / reductionChunkSize, &scratch.arena());
+    parallelFor(batch.size(), reductionChunkSize, [&](std::size_t begin, std::size_t end) {
+        BoundingBox<T, N>& partial = partials[begin / reductionChunkSize];
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            const T* values = batch.component(axis) + begin;
+            if constexpr (VectorBatch<T, N>::hasSimdKernels)
+            {
+                batchKernels().minMax(values, end - begin, &partial.low[axis], &partial.high[axis]);
+            }
+            else
+            {
+                for (std::size_t i = 0; i < end - begin; ++i)
+                {
+                    partial.low[axis] = std::min(partial.low[axis], values[i]);
+                    partial.high[axis] = std::max(partial.high[axis], values[i]);
+                }
+            }
+        }
+    });
+
+    BoundingBox<T, N> result;
+    for (const BoundingBox<T, N>& partial : partials)
+        result.grow(partial);
+    return result;
+}
+
+template <typename T, std::size_t N>
+MagnitudeExtremes<T> magnitudeExtremes(const VectorBatch<T, N>& batch)
+{
+    // Per chunk: squared magnitudes into a scratch buffer, their range with the SIMD
+    // min/max kernel, then the first index holding each end of the range.
+    ArenaScope scratch;
+    std::pmr::vector<MagnitudeExtremes<T>> partials((batch.size() + reductionChunkSize - 1) / reductionChunkSize, &scratch.arena());
+    parallelFor(batch.size(), reductionChunkSize, [&](std::size_t begin, std::size_t end) {
+        ArenaScope chunkScratch;
+        std::size_t count = end - begin;
+        std::pmr::vector<T> squared(count, T(0), &chunkScratch.arena());
+        if constexpr (VectorBatch<T, N>::hasSimdKernels && N == 3)
+        {
+            const T* x = batch.x() + begin;
+            const T* y = batch.y() + begin;
+            const T* z = batch.z() + begin;
+            batchKernels().dotProduct3(x, y, z, x, y, z, squared.data(), count);
+        }
+        else
+        {
+            for (std::size_t axis = 0; axis < N; ++axis)
+            {
+                const T* values = batch.component(axis) + begin;
+                for (std::size_t i = 0; i < count; ++i)
+                    squared[i] += values[i] * values[i];
+            }
+        }
+
+        T low = squared[0];
+        T high = squared[0];
+        if constexpr (VectorBatch<T, N>::hasSimdKernels)
+        {
+            batchKernels().minMax(squared.data(), count, &low, &high);
+        }
+        else
+        {
+            for (T value : squared)
+            {
+                low = std::min(low, value);
+                high = std::max(high, value);
+            }
+        }
+
+        MagnitudeExtremes<T>& partial = partials[begin / reductionChunkSize];
+        partial.minIndex = begin + (std::find(squared.begin(), squared.end(), low) - squared.begin());
+        partial.maxIndex = begin + (std::find(squared.begin(), squared.end(), high) - squared.begin());
+        partial.minMagnitude = low;
+        partial.maxMagnitude = high;
+    });
+
+    // Partials hold squared magnitudes until here.
+    MagnitudeExtremes<T> result;
+    for (const MagnitudeExtremes<T>& partial : partials)
+    {
+        if (result.minIndex == result.npos || partial.minMagnitude < result.minMagnitude)
+        {
+            result.minIndex = partial.minIndex;
+            result.minMagnitude = partial.minMagnitude;
+        }
+        if (result.maxIndex == result.npos || partial.maxMagnitude > result.maxMagnitude)
+        {
+            result.maxIndex = partial.maxIndex;
+            result.maxMagnitude = partial.maxMagnitude;
+        }
+    }
+    result.minMagnitude = std::sqrt(result.minMagnitude);
+    result.maxMagnitude = std::sqrt(result.maxMagnitude);
+    return result;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+#include "vector.hpp"
+
+// Axis-aligned bounding box. A default constructed box is empty (low = +inf, high = -inf),
+// so growing it by the first point or box yields exactly that point or box.
+template <typename T, std::size_t N>
+struct BoundingBox
+{
+    VectorN<T, N> low;
+    VectorN<T, N> high;
+
+    constexpr BoundingBox()
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            low[i] = std::numeric_limits<T>::infinity();
+            high[i] = -std::numeric_limits<T>::infinity();
+        }
+    }
+
+    constexpr BoundingBox(const VectorN<T, N>& low, const VectorN<T, N>& high) : low(low), high(high) {}
+
+    constexpr bool isEmpty() const
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            if (low[i] > high[i])
+                return true;
+        }
+        return false;
+    }
+
+    constexpr void grow(const VectorN<T, N>& point)
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            low[i] = std::min(low[i], point[i]);
+            high[i] = std::max(high[i], point[i]);
+        }
+    }
+
+    constexpr void grow(const BoundingBox& other)
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            low[i] = std::min(low[i], other.low[i]);
+            high[i] = std::max(high[i], other.high[i]);
+        }
+    }
+
+    // Grows every side outwards by margin.
+    constexpr void inflate(T margin)
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            low[i] -= margin;
+            high[i] += margin;
+        }
+    }
+
+    constexpr bool overlaps(const BoundingBox& other) const
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            if (low[i] > other.high[i] || high[i] < other.low[i])
+                return false;
+        }
+        return true;
+    }
+
+    constexpr bool contains(const VectorN<T, N>& point) const
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            if (point[i] < low[i] || point[i] > high[i])
+                return false;
+        }
+        return true;
+    }
+
+    constexpr VectorN<T, N> center() const { return (low + high) * T(0.5); }
+    constexpr VectorN<T, N> extent() const { return high - low; }
+
+    // Squared distance from point to the box, 0 inside.
+    constexpr T distanceSquared(const VectorN<T, N>& point) const
+    {
+        T result = T(0);
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            T d = std::max({ low[i] - point[i], T(0), point[i] - high[i] });
+            result += d * d;
+        }
+        return result;
+    }
+
+    constexpr T surfaceArea() const requires (N == 3)
+    {
+        VectorN<T, N> e = extent();
+        return T(2) * ((e.x * e.y) + (e.y * e.z) + (e.z * e.x));
+    }
+};
+
+using Box2D = BoundingBox<double, 2>;
+using Box3D = BoundingBox<double, 3>;
@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "bvh.hpp"
+
+namespace
+{
+    const std::size_t binCount = 16;
+    const std::size_t maxLeafSize = 8;
+
+    // Entry distance along the normalized direction d, or -1 if the ray misses or starts inside.
+    double sphereHit(const Vector3D& origin, const Vector3D& d, const Vector3D& center, double radius)
+    {
+        Vector3D oc = origin - center;
+        double b = d.dotProduct(oc);
+        double c = oc.magnitudeSquared() - (radius * radius);
+        double h = (b * b) - c;
+        if (h < 0.0)
+            return -1.0;
+        double t = -b - std::sqrt(h);
+        return t >= 0.0 ? t : -1.0;
+    }
+
+    // Ray against the capsule from pa to pb (Inigo Quilez's formulation); d is normalized.
+    double capsuleHit(const Vector3D& origin, const Vector3D& d, const Vector3D& pa, const Vector3D& pb, double radius)
+    {
+        Vector3D ba = pb - pa;
+        Vector3D oa = origin - pa;
+        double baba = ba.magnitudeSquared();
+        double bard = ba.dotProduct(d);
+        double baoa = ba.dotProduct(oa);
+        double a = baba - (bard * bard);
+
+        if (a <= 1e-12 * baba || baba == 0.0)
+        {
+            // Ray parallel to the axis, or a point: only the end spheres can be hit first.
+            double t1 = sphereHit(origin, d, pa, radius);
+            double t2 = sphereHit(origin, d, pb, radius);
+            if (t1 < 0.0)
+                return t2;
+            if (t2 < 0.0)
+                return t1;
+            return std::min(t1, t2);
+        }
+
+        double b = (baba * d.dotProduct(oa)) - (baoa * bard);
+        double c = (baba * oa.magnitudeSquared()) - (baoa * baoa) - (radius * radius * baba);
+        double h = (b * b) - (a * c);
+        if (h < 0.0)
+            return -1.0;
+
+        double t = (-b - std::sqrt(h)) / a;
+        double y = baoa + (t * bard);
+        if (y > 0.0 && y < baba)
+            return t >= 0.0 ? t : -1.0;
+        return sphereHit(origin, d, y <= 0.0 ? pa : pb, radius);
+    }
+
+    // Slab test against [0, maxT]; inverse holds 1 / direction per axis.
+    bool rayHitsBox(const Box3D& box, const Vector3D& origin, const Vector3D& inverse, double maxT)
+    {
+        double tNear = 0.0, tFar = maxT;
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            double t1 = (box.low[axis] - origin[axis]) * inverse[axis];
+            double t2 = (box.high[axis] - origin[axis]) * inverse[axis];
+            tNear = std::max(tNear, std::min(t1, t2));
+            tFar = std::min(tFar, std::max(t1, t2));
+        }
+        return tNear <= tFar;
+    }
+
+    Vector3D closestOnSegment(const Vector3D& query, const Vector3D& a, const Vector3D& b)
+    {
+        Vector3D ab = b - a;
+        double lengthSquared = ab.magnitudeSquared();
+        if (lengthSquared == 0.0)
+            return a;
+        double t = std::clamp((query - a).dotProduct(ab) / lengthSquared, 0.0, 1.0);
+        return a + (ab * t);
+    }
+}
+
+void Bvh::build(const Vector3DBatch& points, const Vector3DBatch& segmentStarts, const Vector3DBatch& segmentEnds, double radius)
+{
+    assert(segmentStarts.size() == segmentEnds.size());
+    this->points = points.size();
+    this->radius = radius;
+
+    std::size_t count = points.size() + segmentStarts.size();
+    assert(count < std::numeric_limits<std::uint32_t>::max());
+    slotPrimitive.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+        slotPrimitive[i] = static_cast<std::uint32_t>(i);
+
+    // Geometry in primitive order first, to get the build inputs.
+    loadGeometry(points, segmentStarts, segmentEnds);
+    std::vector<Box3D> bounds(count);
+    std::vector<Vector3D> centers(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        bounds[i] = slotBounds(i);
+        centers[i] = bounds[i].center();
+    }
+
+    nodes.clear();
+    nodes.reserve(count == 0 ? 0 : 2 * count);
+    if (count > 0)
+        buildNode(bounds, centers, 0, count);
+
+    // Now that the slots are in tree order, lay the geometry out the same way.
+    loadGeometry(points, segmentStarts, segmentEnds);
+}
+
+void Bvh::refit(const Vector3DBatch& points, const Vector3DBatch& segmentStarts, const Vector3DBatch& segmentEnds)
+{
+    assert(points.size() == this->points && points.size() + segmentStarts.size() == slotPrimitive.size());
+    loadGeometry(points, segmentStarts, segmentEnds);
+    refitNodes();
+}
+
+void Bvh::loadGeometry(const Vector3DBatch& points, const Vector3DBatch& segmentStarts, const Vector3DBatch& segmentEnds)
+{
+    slotStart.resize(slotPrimitive.size());
+    slotEnd.resize(slotPrimitive.size());
+    for (std::size_t slot = 0; slot < slotPrimitive.size(); ++slot)
+    {
+        std::size_t id = slotPrimitive[slot];
+        if (id < this->points)
+        {
+            slotStart[slot] = points[id];
+            slotEnd[slot] = slotStart[slot];
+        }
+        else
+        {
+            slotStart[slot] = segmentStarts[id - this->points];
+            slotEnd[slot] = segmentEnds[id - this->points];
+        }
+    }
+}
+
+Box3D Bvh::slotBounds(std::size_t slot) const
+{
+    Box3D box;
+    box.grow(slotStart[slot]);
+    box.grow(slotEnd[slot]);
+    box.inflate(radius);
+    return box;
+}
+
+void Bvh::buildNode(std::vector<Box3D>& bounds, std::vector<Vector3D>& centers, std::size_t begin, std::size_t end)
+{
+    std::size_t index = nodes.size();
+    nodes.push_back({});
+
+    Box3D box, centerBox;
+    for (std::size_t slot = begin; slot < end; ++slot)
+    {
+        box.grow(bounds[slotPrimitive[slot]]);
+        centerBox.grow(centers[slotPrimitive[slot]]);
+    }
+    nodes[index].bounds = box;
+
+    auto makeLeaf = [&]() {
+        nodes[index].first = static_cast<std::uint32_t>(begin);
+        nodes[index].count = static_cast<std::uint32_t>(end - begin);
+        nodes[index].skip = static_cast<std::uint32_t>(nodes.size());
+    };
+
+    std::size_t count = end - begin;
+    Vector3D extent = centerBox.extent();
+    std::size_t axis = 0;
+    if (extent.y > extent[axis])
+        axis = 1;
+    if (extent.z > extent[axis])
+        axis = 2;
+    if (count <= 2 || extent[axis] <= 0.0)
+        return makeLeaf();
+
+    // Bin the centers along the widest axis and sweep for the cheapest split.
+    const double lowest = centerBox.low[axis];
+    const double binScale = binCount / extent[axis];
+    auto binOf = [&](std::uint32_t primitive) {
+        std::size_t bin = static_cast<std::size_t>((centers[primitive][axis] - lowest) * binScale);
+        return std::min(bin, binCount - 1);
+    };
+
+    std::size_t binSizes[binCount] = {};
+    Box3D binBoxes[binCount];
+    for (std::size_t slot = begin; slot < end; ++slot)
+    {
+        std::size_t bin = binOf(slotPrimitive[slot]);
+        ++binSizes[bin];
+        binBoxes[bin].grow(bounds[slotPrimitive[slot]]);
+    }
+
+    double rightCost[binCount] = {};
+    Box3D sweep;
+    std::size_t sweepCount = 0;
+    for (std::size_t bin = binCount - 1; bin > 0; --bin)
+    {
+        sweep.grow(binBoxes[bin]);
+        sweepCount += binSizes[bin];
+        rightCost[bin] = sweepCount == 0 ? 0.0 : sweepCount * sweep.surfaceArea();
+    }
+
+    double bestCost = std::numeric_limits<double>::infinity();
+    std::size_t bestSplit = 0; // first bin of the right side
+    sweep = Box3D();
+    sweepCount = 0;
+    for (std::size_t split = 1; split < binCount; ++split)
+    {
+        sweep.grow(binBoxes[split - 1]);
+        sweepCount += binSizes[split - 1];
+        if (sweepCount == 0 || sweepCount == count)
+            continue;
+        double cost = (sweepCount * sweep.surfaceArea()) + rightCost[split];
+        if (cost < bestCost)
+        {
+            bestCost = cost;
+            bestSplit = split;
+        }
+    }
+
+    // Stop when splitting is not expected to beat testing every primitive (traversal cost 1).
+    double leafCost = count * box.surfaceArea();
+    if (bestSplit == 0 || (count <= maxLeafSize && box.surfaceArea() + bestCost >= leafCost))
+        return makeLeaf();
+
+    auto middle = std::partition(slotPrimitive.begin() + begin, slotPrimitive.begin() + end,
+                                 [&](std::uint32_t primitive) { return binOf(primitive) < bestSplit; });
+    std::size_t mid = static_cast<std::size_t>(middle - slotPrimitive.begin());
+
+    nodes[index].first = 0;
+    nodes[index].count = 0;
+    buildNode(bounds, centers, begin, mid);
+    buildNode(bounds, centers, mid, end);
+    nodes[index].skip = static_cast<std::uint32_t>(nodes.size());
+}
+
+void Bvh::refitNodes()
+{
+    // Children always follow their parent, so a reverse sweep sees them first.
+    for (std::size_t i = nodes.size(); i-- > 0;)
+    {
+        Node& node = nodes[i];
+        Box3D box;
+        if (node.count > 0)
+        {
+            for (std::size_t slot = node.first; slot < node.first + node.count; ++slot)
+                box.grow(slotBounds(slot));
+        }
+        else
+        {
+            const Node& left = nodes[i + 1];
+            box.grow(left.bounds);
+            box.grow(nodes[left.skip].bounds);
+        }
+        node.bounds = box;
+    }
+}
+
+bool Bvh::intersectRay(const Vector3D& origin, const Vector3D& direction, double maxT, RayHit& hit) const
+{
+    double length = direction.magnitude();
+    if (length == 0.0 || nodes.empty())
+        return false;
+
+    // Traverse in unit-length steps; report t in the caller's units.
+    Vector3D d = direction * (1.0 / length);
+    Vector3D inverse(1.0 / d.x, 1.0 / d.y, 1.0 / d.z);
+    double best = maxT * length;
+    bool found = false;
+
+    std::size_t i = 0;
+    while (i < nodes.size())
+    {
+        const Node& node = nodes[i];
+        if (!rayHitsBox(node.bounds, origin, inverse, best))
+        {
+            i = node.skip;
+            continue;
+        }
+        if (node.count == 0)
+        {
+            ++i;
+            continue;
+        }
+        for (std::size_t slot = node.first; slot < node.first + node.count; ++slot)
+        {
+            double t = capsuleHit(origin, d, slotStart[slot], slotEnd[slot], radius);
+            if (t >= 0.0 && t <= best)
+            {
+                best = t;
+                hit.primitive = slotPrimitive[slot];
+                found = true;
+            }
+        }
+        i = node.skip;
+    }
+
+    if (found)
+        hit.t = best / length;
+    return found;
+}
+
+void Bvh::queryBox(const Box3D& box, std::vector<std::size_t>& out) const
+{
+    out.clear();
+    std::size_t i = 0;
+    while (i < nodes.size())
+    {
+        const Node& node = nodes[i];
+        if (!node.bounds.overlaps(box))
+        {
+            i = node.skip;
+            continue;
+        }
+        if (node.count == 0)
+        {
+            ++i;
+            continue;
+        }
+        for (std::size_t slot = node.first; slot < node.first + node.count; ++slot)
+        {
+            if (slotBounds(slot).overlaps(box))
+                out.push_back(slotPrimitive[slot]);
+        }
+        i = node.skip;
+    }
+}
+
+bool Bvh::closestPoint(const Vector3D& query, ClosestHit& hit) const
+{
+    double best = std::numeric_limits<double>::infinity();
+    bool found = false;
+    auto testLeaf = [&](const Node& node) {
+        for (std::size_t slot = node.first; slot < node.first + node.count; ++slot)
+        {
+            Vector3D point = closestOnSegment(query, slotStart[slot], slotEnd[slot]);
+            double distanceSquared = query.distanceSquared(point);
+            if (distanceSquared < best)
+            {
+                best = distanceSquared;
+                hit = { slotPrimitive[slot], point, distanceSquared };
+                found = true;
+            }
+        }
+    };
+    if (nodes.empty())
+        return false;
+
+    // The skip order cannot visit the nearer child first, so seed the bound from the leaf
+    // reached by always stepping into the nearer child; otherwise nothing prunes until the
+    // traversal happens upon a close leaf.
+    std::size_t i = 0;
+    while (nodes[i].count == 0)
+    {
+        std::size_t left = i + 1, right = nodes[left].skip;
+        i = nodes[left].bounds.distanceSquared(query) <= nodes[right].bounds.distanceSquared(query) ? left : right;
+    }
+    std::size_t seeded = i;
+    testLeaf(nodes[seeded]);
+
+    i = 0;
+    while (i < nodes.size())
+    {
+        const Node& node = nodes[i];
+        // Node bounds include the radius, so they stay a valid lower bound.
+        if (node.bounds.distanceSquared(query) > best)
+        {
+            i = node.skip;
+            continue;
+        }
+        if (node.count == 0)
+        {
+            ++i;
+            continue;
+        }
+        if (i != seeded)
+            testLeaf(node);
+        i = node.skip;
+    }
+    return found;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bounding_box.hpp"
+#include "vector.hpp"
+#include "vector_batch.hpp"
+
+// Bounding volume hierarchy over 3D points and line segments.
+//
+// Every primitive is a capsule: a segment from start to end thickened by radius. A point is
+// a segment whose ends coincide, so points become spheres. Primitive ids run over the points
+// first, then the segments: id < pointCount() is a point, otherwise segment id - pointCount().
+//
+// The tree is built top-down with the binned surface area heuristic. Nodes are stored in
+// depth-first order with a skip index to the next node outside their subtree, so queries walk
+// the array without a stack: descend to i + 1 on a hit, jump to skip on a miss. refit()
+// recomputes the bounds for moved primitives without rebuilding the tree.
+class Bvh
+{
+public:
+    struct RayHit
+    {
+        std::size_t primitive;
+        double t; // hit point is origin + direction * t
+    };
+
+    struct ClosestHit
+    {
+        std::size_t primitive;
+        Vector3D point;         // closest point on the primitive's point or segment
+        double distanceSquared; // from the query to point (radius not subtracted)
+    };
+
+    Bvh() = default;
+
+    // segmentStarts and segmentEnds must have the same size; either input may be empty.
+    void build(const Vector3DBatch& points, const Vector3DBatch& segmentStarts, const Vector3DBatch& segmentEnds, double radius = 0.0);
+
+    // Same primitive counts as the last build, new positions. Keeps the tree topology, so
+    // query cost slowly degrades as primitives drift; rebuild when it matters.
+    void refit(const Vector3DBatch& points, const Vector3DBatch& segmentStarts, const Vector3DBatch& segmentEnds);
+
+    std::size_t pointCount() const { return points; }
+    std::size_t primitiveCount() const { return slotPrimitive.size(); }
+
+    // Closest hit with t in [0, maxT]. direction need not be normalized.
+    bool intersectRay(const Vector3D& origin, const Vector3D& direction, double maxT, RayHit& hit) const;
+
+    // Every primitive whose capsule bounds overlap box, in no particular order.
+    void queryBox(const Box3D& box, std::vector<std::size_t>& out) const;
+
+    // Primitive closest to query. Returns false if the hierarchy is empty.
+    bool closestPoint(const Vector3D& query, ClosestHit& hit) const;
+
+private:
+    struct Node
+    {
+        Box3D bounds;
+        std::uint32_t skip;  // next node after this subtree
+        std::uint32_t first; // first primitive slot (leaves)
+        std::uint32_t count; // primitive slots, 0 for inner nodes
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Vector3D> slotStart, slotEnd;   // primitive geometry in tree order
+    std::vector<std::uint32_t> slotPrimitive;   // tree order -> primitive id
+    std::size_t points = 0;
+    double radius = 0.0;
+
+    void loadGeometry(const Vector3DBatch& points, const Vector3DBatch& segmentStarts, const Vector3DBatch& segmentEnds);
+    Box3D slotBounds(std::size_t slot) const;
+    void buildNode(std::vector<Box3D>& bounds, std::vector<Vector3D>& centers, std::size_t begin, std::size_t end);
+    void refitNodes();
+};
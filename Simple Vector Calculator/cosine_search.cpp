@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cmath>
+#include <memory_resource>
+
+#include "arena.hpp"
+#include "cosine_search.hpp"
+#include "parallel.hpp"
+#include "search_common.hpp"
+#include "vector_simd.hpp"
+
+namespace
+{
+    using Result = CosineSearch::Result;
+
+    constexpr std::size_t blockSize = 64;  // stored vectors scored at once, 256 bytes per dimension
+    constexpr std::size_t queryGroup = 64; // queries sharing each block while it is in cache
+
+    using detail::better;
+    using detail::normalizeInto;
+    using detail::offer;
+}
+
+CosineSearch::CosineSearch(std::size_t dimension) : columns(dimension)
+{
+    assert(dimension > 0);
+}
+
+void CosineSearch::reserve(std::size_t capacity)
+{
+    for (std::vector<float>& column : columns)
+        column.reserve(capacity);
+}
+
+std::size_t CosineSearch::add(const float* vector)
+{
+    ArenaScope scratch;
+    std::pmr::vector<float> unit(dimension(), &scratch.arena());
+    normalizeInto(batchKernels(), vector, unit.data(), unit.size());
+    for (std::size_t axis = 0; axis < unit.size(); ++axis)
+        columns[axis].push_back(unit[axis]);
+    return count++;
+}
+
+void CosineSearch::search(const float* query, std::size_t k, std::vector<Result>& out) const
+{
+    out.resize(k);
+    searchBatch(query, 1, k, out.data());
+    out.resize(std::min(k, count));
+}
+
+void CosineSearch::searchBatch(const float* queries, std::size_t queryCount, std::size_t k, Result* out) const
+{
+    if (queryCount == 0 || k == 0)
+        return;
+    const BatchKernels& kernels = batchKernels();
+    const std::size_t dims = dimension();
+
+    // Scratch space comes from the arena of the thread using it.
+    ArenaScope scratch;
+    std::pmr::vector<float> units(queryCount * dims, &scratch.arena());
+    for (std::size_t q = 0; q < queryCount; ++q)
+        normalizeInto(kernels, queries + (q * dims), units.data() + (q * dims), dims);
+
+    // One contiguous run of blocks per thread, each with its own heap per query.
+    std::size_t blocks = (count + blockSize - 1) / blockSize;
+    unsigned int threads = static_cast<unsigned int>(std::clamp<std::size_t>(blocks, 1, workerThreadCount()));
+    // Heaps are reserved here, so the threads filling them never allocate.
+    std::pmr::vector<std::pmr::vector<Result>> heaps(threads * queryCount, &scratch.arena());
+    for (std::pmr::vector<Result>& heap : heaps)
+        heap.reserve(k);
+
+    parallelFor(threads, 1, [&](std::size_t begin, std::size_t end) {
+        ArenaScope workerScratch;
+        std::pmr::vector<float> scores(queryGroup * blockSize, &workerScratch.arena());
+        std::pmr::vector<const float*> blockColumns(dims, &workerScratch.arena());
+        for (std::size_t thread = begin; thread < end; ++thread)
+        {
+            std::pmr::vector<Result>* threadHeaps = heaps.data() + (thread * queryCount);
+            for (std::size_t block = (blocks * thread) / threads; block < (blocks * (thread + 1)) / threads; ++block)
+            {
+                std::size_t first = block * blockSize;
+                std::size_t n = std::min(blockSize, count - first);
+                for (std::size_t axis = 0; axis < dims; ++axis)
+                    blockColumns[axis] = columns[axis].data() + first;
+                for (std::size_t group = 0; group < queryCount; group += queryGroup)
+                {
+                    std::size_t groupSize = std::min(queryGroup, queryCount - group);
+                    kernels.columnDotProductsF32(blockColumns.data(), units.data() + (group * dims), groupSize, dims, scores.data(), n);
+                    for (std::size_t q = 0; q < groupSize; ++q)
+                    {
+                        // Most scores lose against a full heap; test those against a cached
+                        // threshold before touching the heap.
+                        std::pmr::vector<Result>& heap = threadHeaps[group + q];
+                        const float* row = scores.data() + (q * n);
+                        float threshold = heap.size() < k ? -std::numeric_limits<float>::infinity() : heap.front().similarity;
+                        for (std::size_t i = 0; i < n; ++i)
+                        {
+                            if (row[i] >= threshold)
+                            {
+                                offer(heap, k, { first + i, row[i] });
+                                if (heap.size() == k)
+                                    threshold = heap.front().similarity;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }, threads);
+
+    // Merge the per-thread heaps of every query.
+    std::pmr::vector<Result> merged(&scratch.arena());
+    for (std::size_t q = 0; q < queryCount; ++q)
+    {
+        merged.clear();
+        for (unsigned int thread = 0; thread < threads; ++thread)
+        {
+            const std::pmr::vector<Result>& heap = heaps[(thread * queryCount) + q];
+            merged.insert(merged.end(), heap.begin(), heap.end());
+        }
+        std::size_t found = std::min(k, merged.size());
+        std::partial_sort(merged.begin(), merged.begin() + found, merged.end(), better);
+        Result* row = out + (q * k);
+        std::copy(merged.begin(), merged.begin() + found, row);
+        std::fill(row + found, row + k, Result{ npos, -std::numeric_limits<float>::infinity() });
+    }
+}
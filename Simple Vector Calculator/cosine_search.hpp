@@ -0,0 +1,58 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "vector.hpp"
+
+// Exact top-k cosine similarity search by brute force, the baseline for approximate indexes
+// such as HnswIndex.
+//
+// Vectors are normalized once when added, so a similarity is a plain dot product. They are
+// stored dimension-major (one array per dimension, like the components of a VectorBatch), so
+// scoring a block of vectors against a query is one SIMD axpy per dimension over contiguous
+// memory. Queries are scored in groups: each block of stored vectors is streamed from memory
+// once per group and reused from cache by every query in it. The blocks are split over the
+// worker threads; every thread keeps a bounded heap per query and the heaps are merged at
+// the end.
+class CosineSearch
+{
+public:
+    struct Result
+    {
+        std::size_t id;
+        float similarity; // cosine similarity, in [-1, 1]
+    };
+
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    explicit CosineSearch(std::size_t dimension);
+
+    std::size_t dimension() const { return columns.size(); }
+    std::size_t size() const { return count; }
+    void reserve(std::size_t capacity);
+
+    // Adds a vector of dimension() floats and returns its id; ids are consecutive from 0.
+    std::size_t add(const float* vector);
+    template <typename T, std::size_t N>
+    std::size_t add(const VectorN<T, N>& vector)
+    {
+        assert(N == dimension());
+        VectorN<T, N> unit = vector.normalize();
+        for (std::size_t axis = 0; axis < N; ++axis)
+            columns[axis].push_back(static_cast<float>(unit[axis]));
+        return count++;
+    }
+
+    // The k most similar vectors to query, most similar first; ties go to the lower id.
+    void search(const float* query, std::size_t k, std::vector<Result>& out) const;
+
+    // queryCount queries stored back to back. Query q writes its k results to out[q * k]
+    // onwards; missing results are {npos, -infinity}.
+    void searchBatch(const float* queries, std::size_t queryCount, std::size_t k, Result* out) const;
+
+private:
+    std::vector<std::vector<float>> columns; // columns[axis][id], normalized
+    std::size_t count = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+
+// 16-bit floating-point storage formats, held as raw bits and widened to float for
+// arithmetic. Narrowing rounds to nearest, ties to even.
+//   Float16   IEEE binary16: 5 exponent and 10 mantissa bits. About 3 significant decimal
+//             digits (relative error up to 2^-11), range 6e-8 (subnormal) to 65504.
+//   BFloat16  the top half of a float: 8 exponent and 7 mantissa bits. About 2 digits
+//             (relative error up to 2^-8) but the full float range.
+enum class HalfFormat
+{
+    Float16,
+    BFloat16
+};
+
+inline float halfToFloat(std::uint16_t half)
+{
+    std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000u) << 16;
+    std::uint32_t exponent = (half >> 10) & 0x1Fu;
+    std::uint32_t mantissa = half & 0x3FFu;
+    if (exponent == 0x1F) // infinity or NaN
+        return std::bit_cast<float>(sign | 0x7F800000u | (mantissa << 13));
+    if (exponent == 0) // zero or subnormal, mantissa * 2^-24
+    {
+        float value = static_cast<float>(mantissa) * 0x1p-24f;
+        return sign != 0 ? -value : value;
+    }
+    return std::bit_cast<float>(sign | ((exponent + (127 - 15)) << 23) | (mantissa << 13));
+}
+
+inline std::uint16_t floatToHalf(float value)
+{
+    std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+    std::uint32_t sign = (bits >> 16) & 0x8000u;
+    std::uint32_t magnitude = bits & 0x7FFFFFFFu;
+    if (magnitude >= 0x7F800000u) // infinity, or NaN kept quiet
+        return static_cast<std::uint16_t>(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x200u : 0u));
+    if (magnitude >= 0x477FF000u) // 65520 and up round to infinity
+        return static_cast<std::uint16_t>(sign | 0x7C00u);
+    if (magnitude < 0x38800000u)
+    {
+        // Below the smallest normal half, 2^-14. Adding 0.5 leaves the float with a unit in
+        // the last place of 2^-24, the half subnormal spacing, so the float add does the
+        // rounding and the mantissa bits are the result.
+        float shifted = std::bit_cast<float>(magnitude) + 0.5f;
+        return static_cast<std::uint16_t>(sign | (std::bit_cast<std::uint32_t>(shifted) - 0x3F000000u));
+    }
+    // Rebias the exponent and round the mantissa from 23 to 10 bits.
+    std::uint32_t odd = (magnitude >> 13) & 1u;
+    magnitude += (static_cast<std::uint32_t>(15 - 127) << 23) + 0xFFFu + odd;
+    return static_cast<std::uint16_t>(sign | (magnitude >> 13));
+}
+
+inline float bfloat16ToFloat(std::uint16_t value)
+{
+    return std::bit_cast<float>(static_cast<std::uint32_t>(value) << 16);
+}
+
+inline std::uint16_t floatToBFloat16(float value)
+{
+    std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+    if ((bits & 0x7FFFFFFFu) > 0x7F800000u) // NaN: truncate, but keep it quiet so it stays NaN
+        return static_cast<std::uint16_t>((bits >> 16) | 0x40u);
+    bits += 0x7FFFu + ((bits >> 16) & 1u);
+    return static_cast<std::uint16_t>(bits >> 16);
+}
@@ -0,0 +1,263 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "arena.hpp"
+#include "half.hpp"
+#include "vector.hpp"
+#include "vector_batch.hpp"
+#include "vector_simd.hpp"
+
+// Structure-of-arrays batch like VectorBatch<float, N>, stored at 16 bits per component
+// (Float16 or BFloat16, see half.hpp) to halve the memory traffic of bandwidth-bound passes.
+// Components are widened to float for computation (with F16C on AVX2 and AVX-512): in
+// registers by the fused 3D magnitude and dotProduct kernels, otherwise blockSize elements
+// at a time into a float scratch batch from threadArena() (arena.hpp) that stays in cache,
+// running the VectorBatch<float, N> code on it. Either way the results are those of float
+// storage of the rounded values, up to the rounding of fused multiply-adds.
+template <HalfFormat Format, std::size_t N>
+class HalfBatch
+{
+public:
+    using vector_type = VectorN<float, N>;
+
+    static constexpr HalfFormat format = Format;
+    static constexpr std::size_t blockSize = 1024; // 4 KB of floats per component
+
+    HalfBatch() = default;
+    explicit HalfBatch(std::size_t count) { resize(count); }
+    explicit HalfBatch(const VectorBatch<float, N>& batch) { assign(batch); }
+
+    std::size_t size() const { return components[0].size(); }
+    bool empty() const { return components[0].empty(); }
+
+    void resize(std::size_t count)
+    {
+        for (auto& component : components)
+            component.resize(count);
+    }
+
+    void clear()
+    {
+        for (auto& component : components)
+            component.clear();
+    }
+
+    vector_type operator[](std::size_t i) const
+    {
+        vector_type v;
+        for (std::size_t axis = 0; axis < N; ++axis)
+            v[axis] = toFloat(components[axis][i]);
+        return v;
+    }
+
+    void set(std::size_t i, const vector_type& v)
+    {
+        for (std::size_t axis = 0; axis < N; ++axis)
+            components[axis][i] = fromFloat(v[axis]);
+    }
+
+    // Raw 16-bit values of one component, size() elements long.
+    const std::uint16_t* component(std::size_t axis) const { return components[axis].data(); }
+
+    // Rounds every component of batch to the storage format.
+    void assign(const VectorBatch<float, N>& batch)
+    {
+        resize(batch.size());
+        const BatchKernels& kernels = batchKernels();
+        for (std::size_t axis = 0; axis < N; ++axis)
+            narrow(kernels, batch.component(axis), components[axis].data(), size());
+    }
+
+    void widen(VectorBatch<float, N>& out) const
+    {
+        out.resize(size());
+        const BatchKernels& kernels = batchKernels();
+        for (std::size_t axis = 0; axis < N; ++axis)
+            widen(kernels, components[axis].data(), out.component(axis), size());
+    }
+
+    // Batch versions of the VectorN operations, writing to a caller buffer of size() floats.
+    void magnitude(float* out) const
+    {
+        if constexpr (N == 3)
+        {
+            const BatchKernels& kernels = batchKernels();
+            (Format == HalfFormat::Float16 ? kernels.magnitude3F16 : kernels.magnitude3BF16)(
+                component(0), component(1), component(2), out, size());
+            return;
+        }
+        forEachBlock(nullptr, [&](const VectorBatch<float, N>& a, const VectorBatch<float, N>&, std::size_t first) {
+            a.magnitude(out + first);
+        });
+    }
+
+    void dotProduct(const HalfBatch& other, float* out) const
+    {
+        if constexpr (N == 3)
+        {
+            assert(other.size() == size());
+            const BatchKernels& kernels = batchKernels();
+            (Format == HalfFormat::Float16 ? kernels.dotProduct3F16 : kernels.dotProduct3BF16)(
+                component(0), component(1), component(2), other.component(0), other.component(1), other.component(2), out, size());
+            return;
+        }
+        forEachBlock(&other, [&](const VectorBatch<float, N>& a, const VectorBatch<float, N>& b, std::size_t first) {
+            a.dotProduct(b, out + first);
+        });
+    }
+
+    void angleBetween(const HalfBatch& other, float* out, AngleUnit unit = AngleUnit::Degrees) const
+    {
+        forEachBlock(&other, [&](const VectorBatch<float, N>& a, const VectorBatch<float, N>& b, std::size_t first) {
+            a.angleBetween(b, out + first, unit);
+        });
+    }
+
+private:
+    std::array<std::vector<std::uint16_t>, N> components;
+
+    static float toFloat(std::uint16_t value)
+    {
+        return Format == HalfFormat::Float16 ? halfToFloat(value) : bfloat16ToFloat(value);
+    }
+
+    static std::uint16_t fromFloat(float value)
+    {
+        return Format == HalfFormat::Float16 ? floatToHalf(value) : floatToBFloat16(value);
+    }
+
+    static void widen(const BatchKernels& kernels, const std::uint16_t* in, float* out, std::size_t n)
+    {
+        (Format == HalfFormat::Float16 ? kernels.widenF16 : kernels.widenBF16)(in, out, n);
+    }
+
+    static void narrow(const BatchKernels& kernels, const float* in, std::uint16_t* out, std::size_t n)
+    {
+        (Format == HalfFormat::Float16 ? kernels.narrowF16 : kernels.narrowBF16)(in, out, n);
+    }
+
+    // body(a, b, first) for every block, with a (and b, when other is given) holding the
+    // widened elements [first, first + blockSize). Both live in the calling thread's arena.
+    template <typename F>
+    void forEachBlock(const HalfBatch* other, F body) const
+    {
+        assert(other == nullptr || other->size() == size());
+        ArenaScope scratch;
+        VectorBatch<float, N> a(std::min(blockSize, size()), &scratch.arena());
+        VectorBatch<float, N> b(other != nullptr ? a.size() : 0, &scratch.arena());
+        const BatchKernels& kernels = batchKernels();
+        for (std::size_t first = 0; first < size(); first += blockSize)
+        {
+            std::size_t count = std::min(blockSize, size() - first);
+            a.resize(count);
+            b.resize(other != nullptr ? count : 0);
+            for (std::size_t axis = 0; axis < N; ++axis)
+            {
+                widen(kernels, components[axis].data() + first, a.component(axis), count);
+                if (other != nullptr)
+                    widen(kernels, other->components[axis].data() + first, b.component(axis), count);
+            }
+            body(a, b, first);
+        }
+    }
+};
+
+using Vector3HalfBatch = HalfBatch<HalfFormat::Float16, 3>;
+using Vector3BFloat16Batch = HalfBatch<HalfFormat::BFloat16, 3>;
+
+// What 16-bit storage costs in accuracy and gains in speed, measured on the caller's data
+// against float storage. Errors are the largest and root-mean-square over all elements:
+// magnitude relative to the float result, dotProduct relative to |a| |b| (an absolute error
+// in the cosine), angleBetween in degrees. The throughputs are of one dotProduct pass over
+// the whole batches, in elements per second, best of a few runs. For 3D batches both sides
+// run SIMD kernels of the same instruction set, dotProduct3F32 against the widening 16-bit
+// kernel, so their ratio is what the smaller storage saves; other sizes run the
+// VectorBatch<float, N> loops on both sides, after widening for the 16-bit one.
+struct HalfPrecisionReport
+{
+    struct Error
+    {
+        double max = 0.0;
+        double rms = 0.0;
+    };
+
+    Error magnitude;
+    Error dotProduct;
+    Error angleBetween;
+    std::size_t floatBytesPerElement = 0; // both operands
+    std::size_t halfBytesPerElement = 0;
+    double floatElementsPerSecond = 0.0;
+    double halfElementsPerSecond = 0.0;
+};
+
+template <HalfFormat Format, std::size_t N>
+HalfPrecisionReport measureHalfPrecision(const VectorBatch<float, N>& a, const VectorBatch<float, N>& b, int runs = 5)
+{
+    assert(a.size() == b.size());
+    HalfBatch<Format, N> halfA(a), halfB(b);
+    std::size_t count = a.size();
+    std::vector<float> exact(count), rounded(count), lengthsA(count), lengthsB(count);
+
+    auto accumulate = [&](HalfPrecisionReport::Error& error, auto scaleOf) {
+        double squares = 0.0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            double scale = scaleOf(i);
+            double e = scale > 0.0 ? std::abs(static_cast<double>(rounded[i]) - exact[i]) / scale : 0.0;
+            error.max = std::max(error.max, e);
+            squares += e * e;
+        }
+        error.rms = count == 0 ? 0.0 : std::sqrt(squares / static_cast<double>(count));
+    };
+
+    HalfPrecisionReport report;
+    a.magnitude(exact.data());
+    halfA.magnitude(rounded.data());
+    accumulate(report.magnitude, [&](std::size_t i) { return static_cast<double>(exact[i]); });
+
+    a.magnitude(lengthsA.data());
+    b.magnitude(lengthsB.data());
+    a.dotProduct(b, exact.data());
+    halfA.dotProduct(halfB, rounded.data());
+    accumulate(report.dotProduct, [&](std::size_t i) { return static_cast<double>(lengthsA[i]) * lengthsB[i]; });
+
+    a.angleBetween(b, exact.data());
+    halfA.angleBetween(halfB, rounded.data());
+    accumulate(report.angleBetween, [](std::size_t) { return 1.0; });
+
+    auto bestSeconds = [&](auto pass) {
+        double best = 0.0;
+        for (int run = 0; run < runs; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            pass();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = run == 0 ? seconds : std::min(best, seconds);
+        }
+        return best;
+    };
+    double floatSeconds = bestSeconds([&] {
+        if constexpr (N == 3)
+        {
+            batchKernels().dotProduct3F32(a.component(0), a.component(1), a.component(2), b.component(0), b.component(1), b.component(2),
+                                          exact.data(), count);
+        }
+        else
+        {
+            a.dotProduct(b, exact.data());
+        }
+    });
+    double halfSeconds = bestSeconds([&] { halfA.dotProduct(halfB, rounded.data()); });
+    report.floatBytesPerElement = 2 * N * sizeof(float);
+    report.halfBytesPerElement = 2 * N * sizeof(std::uint16_t);
+    report.floatElementsPerSecond = floatSeconds > 0.0 ? static_cast<double>(count) / floatSeconds : 0.0;
+    report.halfElementsPerSecond = halfSeconds > 0.0 ? static_cast<double>(count) / halfSeconds : 0.0;
+    return report;
+}
@@ -0,0 +1,471 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+
+#include "hnsw.hpp"
+#include "parallel.hpp"
+#include "search_common.hpp"
+
+namespace
+{
+    constexpr std::uint32_t fileMagic = 0x57534E48; // "HNSW"
+    constexpr std::uint32_t fileVersion = 1;
+    constexpr int levelLimit = 31;
+
+    using detail::normalizeInto;
+
+    // Per-thread visited marks, sized to the largest index searched on the thread. Bumping the
+    // epoch clears every mark at once. parallelFor runs on long-lived WorkerPool threads, so a
+    // thread allocates and zero-fills its set once, not once per searchBatch or addBatch call.
+    struct VisitedSet
+    {
+        std::vector<std::uint32_t> marks;
+        std::uint32_t epoch = 0;
+
+        void reset(std::size_t size)
+        {
+            if (marks.size() < size)
+                marks.resize(size, 0);
+            if (++epoch == 0)
+            {
+                std::fill(marks.begin(), marks.end(), 0);
+                epoch = 1;
+            }
+        }
+
+        // Marks id and returns whether it was already marked.
+        bool visit(std::uint32_t id)
+        {
+            if (marks[id] == epoch)
+                return true;
+            marks[id] = epoch;
+            return false;
+        }
+    };
+
+    thread_local VisitedSet visited;
+
+    template <typename T>
+    void writeValues(std::ofstream& file, const T* values, std::size_t count)
+    {
+        file.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+    }
+
+    template <typename T>
+    void readValues(std::ifstream& file, T* values, std::size_t count)
+    {
+        file.read(reinterpret_cast<char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+        if (!file)
+            throw std::runtime_error("HnswIndex: unexpected end of file");
+    }
+}
+
+HnswIndex::HnswIndex(std::size_t dimension, std::size_t capacity, const HnswParameters& parameters)
+    : dims(dimension), params(parameters)
+{
+    assert(dimension > 0);
+    assert(parameters.M >= 2);
+    allocate(capacity);
+}
+
+void HnswIndex::allocate(std::size_t capacity)
+{
+    assert(capacity < none);
+    maxCount = capacity;
+    kernels = &batchKernels();
+    nodeCount.store(0, std::memory_order_relaxed);
+    data.assign(capacity * dims, 0.0f);
+    levels.assign(capacity, 0);
+    baseLinks.assign(capacity * (2 * params.M + 1), 0);
+    upperLinks.assign(capacity, {});
+    nodeLocks = std::make_unique<std::mutex[]>(capacity);
+    entryPoint = none;
+    maxLevel = -1;
+}
+
+std::uint32_t* HnswIndex::links(std::uint32_t id, int level)
+{
+    if (level == 0)
+        return baseLinks.data() + (id * (2 * params.M + 1));
+    return upperLinks[id].data() + ((level - 1) * (params.M + 1));
+}
+
+const std::uint32_t* HnswIndex::links(std::uint32_t id, int level) const
+{
+    return const_cast<HnswIndex*>(this)->links(id, level);
+}
+
+int HnswIndex::randomLevel(std::uint32_t id) const
+{
+    // splitmix64 of the seed and id, so a node's level does not depend on insertion order.
+    std::uint64_t x = params.seed + ((id + 1ull) * 0x9E3779B97F4A7C15ull);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    double uniform = static_cast<double>((x >> 11) + 1) * 0x1.0p-53; // (0, 1]
+    int level = static_cast<int>(-std::log(uniform) / std::log(static_cast<double>(params.M)));
+    return std::min(level, levelLimit);
+}
+
+std::size_t HnswIndex::add(const float* vector)
+{
+    std::size_t id = nodeCount.fetch_add(1, std::memory_order_acq_rel);
+    assert(id < maxCount);
+    insert(static_cast<std::uint32_t>(id), vector);
+    return id;
+}
+
+std::size_t HnswIndex::addBatch(const float* vectors, std::size_t count)
+{
+    std::size_t first = nodeCount.fetch_add(count, std::memory_order_acq_rel);
+    assert(first + count <= maxCount);
+    parallelFor(count, 16, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            insert(static_cast<std::uint32_t>(first + i), vectors + (i * dims));
+    });
+    return first;
+}
+
+void HnswIndex::insert(std::uint32_t id, const float* vector)
+{
+    float* stored = data.data() + (id * dims);
+    normalizeInto(*kernels, vector, stored, dims);
+    int level = randomLevel(id);
+    levels[id] = static_cast<std::uint8_t>(level);
+    upperLinks[id].assign(level * (params.M + 1), 0);
+
+    // Hold the entry lock throughout if this node becomes the new top, so no other insert
+    // starts from a level this node has not linked yet.
+    std::unique_lock<std::mutex> top(entryLock);
+    if (entryPoint == none)
+    {
+        entryPoint = id;
+        maxLevel = level;
+        return;
+    }
+    std::uint32_t current = entryPoint;
+    int currentMax = maxLevel;
+    if (level <= currentMax)
+        top.unlock();
+
+    for (int l = currentMax; l > level; --l)
+        current = greedyClosest<true>(stored, current, l);
+
+    std::vector<Candidate> found;
+    for (int l = std::min(level, currentMax); l >= 0; --l)
+    {
+        searchLevel<true>(stored, current, params.efConstruction, l, found);
+        current = found.front().second;
+        selectNeighbors(found, params.M);
+        {
+            std::lock_guard<std::mutex> guard(nodeLocks[id]);
+            std::uint32_t* list = links(id, l);
+            list[0] = static_cast<std::uint32_t>(found.size());
+            for (std::size_t i = 0; i < found.size(); ++i)
+                list[i + 1] = found[i].second;
+        }
+        for (const Candidate& neighbor : found)
+            connect(neighbor.second, id, l);
+    }
+
+    if (level > currentMax)
+    {
+        entryPoint = id;
+        maxLevel = level;
+    }
+}
+
+template <bool Locked>
+std::uint32_t HnswIndex::greedyClosest(const float* query, std::uint32_t start, int level) const
+{
+    std::uint32_t current = start;
+    float currentDistance = distance(query, vector(current));
+    std::vector<std::uint32_t> neighbors;
+    bool moved = true;
+    while (moved)
+    {
+        moved = false;
+        {
+            std::unique_lock<std::mutex> guard;
+            if constexpr (Locked)
+                guard = std::unique_lock<std::mutex>(nodeLocks[current]);
+            const std::uint32_t* list = links(current, level);
+            neighbors.assign(list + 1, list + 1 + list[0]);
+        }
+        for (std::uint32_t neighbor : neighbors)
+        {
+            float d = distance(query, vector(neighbor));
+            if (d < currentDistance)
+            {
+                current = neighbor;
+                currentDistance = d;
+                moved = true;
+            }
+        }
+    }
+    return current;
+}
+
+template <bool Locked>
+void HnswIndex::searchLevel(const float* query, std::uint32_t start, std::size_t ef, int level, std::vector<Candidate>& found) const
+{
+    // candidates: closest first, still to expand. results: the ef closest so far, farthest on top.
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+    std::priority_queue<Candidate> results;
+    std::vector<std::uint32_t> neighbors;
+
+    visited.reset(maxCount);
+    visited.visit(start);
+    float startDistance = distance(query, vector(start));
+    candidates.emplace(startDistance, start);
+    results.emplace(startDistance, start);
+
+    while (!candidates.empty())
+    {
+        Candidate closest = candidates.top();
+        if (closest.first > results.top().first && results.size() >= ef)
+            break;
+        candidates.pop();
+        {
+            std::unique_lock<std::mutex> guard;
+            if constexpr (Locked)
+                guard = std::unique_lock<std::mutex>(nodeLocks[closest.second]);
+            const std::uint32_t* list = links(closest.second, level);
+            neighbors.assign(list + 1, list + 1 + list[0]);
+        }
+        for (std::uint32_t neighbor : neighbors)
+        {
+            if (visited.visit(neighbor))
+                continue;
+            float d = distance(query, vector(neighbor));
+            if (results.size() < ef || d < results.top().first)
+            {
+                candidates.emplace(d, neighbor);
+                results.emplace(d, neighbor);
+                if (results.size() > ef)
+                    results.pop();
+            }
+        }
+    }
+
+    found.resize(results.size());
+    for (std::size_t i = found.size(); i > 0; --i)
+    {
+        found[i - 1] = results.top();
+        results.pop();
+    }
+}
+
+void HnswIndex::selectNeighbors(std::vector<Candidate>& candidates, std::size_t count) const
+{
+    // Keep a candidate only if it is closer to the base node than to every neighbor kept so
+    // far. This spreads the links over directions instead of clustering them, which keeps the
+    // graph navigable. candidates must be sorted nearest first.
+    if (candidates.size() <= count)
+        return;
+    std::vector<Candidate> kept;
+    kept.reserve(count);
+    for (const Candidate& candidate : candidates)
+    {
+        if (kept.size() == count)
+            break;
+        const float* point = vector(candidate.second);
+        bool diverse = std::none_of(kept.begin(), kept.end(), [&](const Candidate& other) {
+            return distance(point, vector(other.second)) < candidate.first;
+        });
+        if (diverse)
+            kept.push_back(candidate);
+    }
+    candidates.swap(kept);
+}
+
+void HnswIndex::connect(std::uint32_t node, std::uint32_t neighbor, int level)
+{
+    std::lock_guard<std::mutex> guard(nodeLocks[node]);
+    std::uint32_t* list = links(node, level);
+    std::size_t limit = maxLinks(level);
+    if (list[0] < limit)
+    {
+        list[1 + list[0]++] = neighbor;
+        return;
+    }
+
+    // Full: pick the best limit links out of the old ones plus the new one.
+    const float* base = vector(node);
+    std::vector<Candidate> candidates;
+    candidates.reserve(limit + 1);
+    for (std::size_t i = 1; i <= list[0]; ++i)
+        candidates.emplace_back(distance(base, vector(list[i])), list[i]);
+    candidates.emplace_back(distance(base, vector(neighbor)), neighbor);
+    std::sort(candidates.begin(), candidates.end());
+    selectNeighbors(candidates, limit);
+    list[0] = static_cast<std::uint32_t>(candidates.size());
+    for (std::size_t i = 0; i < candidates.size(); ++i)
+        list[i + 1] = candidates[i].second;
+}
+
+void HnswIndex::search(const float* query, std::size_t k, std::vector<Result>& out) const
+{
+    out.clear();
+    if (size() == 0 || k == 0)
+        return;
+    std::vector<float> normalized(dims);
+    normalizeInto(*kernels, query, normalized.data(), dims);
+
+    std::uint32_t current = entryPoint;
+    for (int l = maxLevel; l > 0; --l)
+        current = greedyClosest<false>(normalized.data(), current, l);
+    std::vector<Candidate> found;
+    searchLevel<false>(normalized.data(), current, std::max(params.efSearch, k), 0, found);
+
+    std::size_t count = std::min(k, found.size());
+    for (std::size_t i = 0; i < count; ++i)
+        out.push_back({ found[i].second, found[i].first });
+}
+
+void HnswIndex::searchBatch(const float* queries, std::size_t queryCount, std::size_t k, Result* out) const
+{
+    parallelFor(queryCount, 16, [&](std::size_t begin, std::size_t end) {
+        std::vector<Result> found;
+        for (std::size_t q = begin; q < end; ++q)
+        {
+            search(queries + (q * dims), k, found);
+            Result* row = out + (q * k);
+            std::copy(found.begin(), found.end(), row);
+            std::fill(row + found.size(), row + k, Result{ npos, std::numeric_limits<float>::infinity() });
+        }
+    });
+}
+
+void HnswIndex::save(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("HnswIndex: cannot open " + path + " for writing");
+
+    std::uint32_t header[2] = { fileMagic, fileVersion };
+    std::uint64_t sizes[6] = { dims, size(), params.M, params.efConstruction, params.efSearch, params.seed };
+    std::int32_t top[2] = { static_cast<std::int32_t>(entryPoint), maxLevel };
+    writeValues(file, header, 2);
+    writeValues(file, sizes, 6);
+    writeValues(file, top, 2);
+
+    // Links are written without their unused slots: per node and level a count, then the ids.
+    std::size_t count = size();
+    writeValues(file, levels.data(), count);
+    writeValues(file, data.data(), count * dims);
+    for (std::uint32_t id = 0; id < count; ++id)
+    {
+        for (int l = 0; l <= levels[id]; ++l)
+        {
+            const std::uint32_t* list = links(id, l);
+            writeValues(file, list, list[0] + 1);
+        }
+    }
+    if (!file)
+        throw std::runtime_error("HnswIndex: failed writing " + path);
+}
+
+void HnswIndex::load(const std::string& path, std::size_t capacity)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("HnswIndex: cannot open " + path);
+
+    std::uint32_t header[2];
+    std::uint64_t sizes[6];
+    std::int32_t top[2];
+    readValues(file, header, 2);
+    if (header[0] != fileMagic || header[1] != fileVersion)
+        throw std::runtime_error("HnswIndex: " + path + " is not an index file of a supported version");
+    readValues(file, sizes, 6);
+    readValues(file, top, 2);
+
+    std::size_t count = sizes[1];
+    if (sizes[0] == 0 || sizes[2] < 2 || count >= none || top[1] > levelLimit || (count > 0) != (top[1] >= 0))
+        throw std::runtime_error("HnswIndex: corrupt header in " + path);
+    dims = sizes[0];
+    params.M = sizes[2];
+    params.efConstruction = sizes[3];
+    params.efSearch = sizes[4];
+    params.seed = sizes[5];
+    allocate(std::max(count, capacity));
+
+    readValues(file, levels.data(), count);
+    readValues(file, data.data(), count * dims);
+    for (std::uint32_t id = 0; id < count; ++id)
+    {
+        if (levels[id] > levelLimit)
+            throw std::runtime_error("HnswIndex: corrupt node level in " + path);
+        upperLinks[id].assign(levels[id] * (params.M + 1), 0);
+        for (int l = 0; l <= levels[id]; ++l)
+        {
+            std::uint32_t* list = links(id, l);
+            readValues(file, list, 1);
+            if (list[0] > maxLinks(l))
+                throw std::runtime_error("HnswIndex: corrupt links in " + path);
+            readValues(file, list + 1, list[0]);
+            if (std::any_of(list + 1, list + 1 + list[0], [&](std::uint32_t neighbor) { return neighbor >= count; }))
+                throw std::runtime_error("HnswIndex: corrupt links in " + path);
+        }
+    }
+
+    entryPoint = count > 0 ? static_cast<std::uint32_t>(top[0]) : none;
+    maxLevel = top[1];
+    if (count > 0 && (entryPoint >= count || levels[entryPoint] != maxLevel))
+        throw std::runtime_error("HnswIndex: corrupt entry point in " + path);
+    nodeCount.store(count, std::memory_order_release);
+}
+
+HnswReport evaluateRecall(const HnswIndex& index, const float* queries, std::size_t queryCount, std::size_t k)
+{
+    using Clock = std::chrono::steady_clock;
+    std::size_t dims = index.dimension();
+    std::size_t count = index.size();
+    const BatchKernels& kernels = batchKernels();
+
+    std::vector<HnswIndex::Result> approximate(queryCount * k);
+    Clock::time_point start = Clock::now();
+    index.searchBatch(queries, queryCount, k, approximate.data());
+    double approximateSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Exact answers by scanning every stored vector.
+    std::size_t expected = std::min(k, count);
+    std::vector<std::size_t> exact(queryCount * expected);
+    start = Clock::now();
+    parallelFor(queryCount, 4, [&](std::size_t begin, std::size_t end) {
+        std::vector<float> normalized(dims);
+        std::vector<std::pair<float, std::size_t>> scored(count);
+        for (std::size_t q = begin; q < end; ++q)
+        {
+            normalizeInto(kernels, queries + (q * dims), normalized.data(), dims);
+            for (std::size_t id = 0; id < count; ++id)
+                scored[id] = { 1.0f - kernels.dotProductF32(normalized.data(), index.vector(id), dims), id };
+            std::partial_sort(scored.begin(), scored.begin() + expected, scored.end());
+            for (std::size_t i = 0; i < expected; ++i)
+                exact[(q * expected) + i] = scored[i].second;
+        }
+    });
+    double exactSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::size_t hits = 0;
+    for (std::size_t q = 0; q < queryCount; ++q)
+    {
+        const std::size_t* truth = exact.data() + (q * expected);
+        for (std::size_t i = 0; i < k; ++i)
+        {
+            if (std::find(truth, truth + expected, approximate[(q * k) + i].id) != truth + expected)
+                ++hits;
+        }
+    }
+
+    HnswReport report;
+    report.recall = queryCount * expected == 0 ? 1.0 : static_cast<double>(hits) / static_cast<double>(queryCount * expected);
+    report.queriesPerSecond = approximateSeconds > 0.0 ? queryCount / approximateSeconds : 0.0;
+    report.bruteForceQueriesPerSecond = exactSeconds > 0.0 ? queryCount / exactSeconds : 0.0;
+    return report;
+}
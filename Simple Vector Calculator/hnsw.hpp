@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vector_simd.hpp"
+
+// Build and search settings of an HnswIndex, see below.
+struct HnswParameters
+{
+    std::size_t M = 16;               // links per node on the upper levels, 2M on level 0
+    std::size_t efConstruction = 200; // search width while inserting
+    std::size_t efSearch = 64;        // search width of queries, at least k
+    std::uint64_t seed = 42;          // for the random node levels
+};
+
+// Hierarchical navigable small world graph (Malkov and Yashunin) for approximate
+// nearest-neighbor search over high dimensional float vectors, such as embeddings.
+//
+// Vectors are normalized when they are added and compared by cosine distance, 1 - cos, so a
+// distance is a single SIMD dot product. Every node sits on level 0 and on each level above
+// with probability 1/M; a search walks greedily down the sparse upper levels and then runs a
+// best-first search of width ef on level 0. M sets the links per node (2M on level 0) and
+// trades memory and build time for recall; efConstruction does the same for the build alone,
+// efSearch for every query.
+//
+// add() and addBatch() may run from several threads at once: every node has its own lock and
+// the insert path locks each neighbor list it reads or writes. Searches take no locks, so
+// they must not overlap with insertions.
+class HnswIndex
+{
+public:
+    struct Result
+    {
+        std::size_t id;
+        float distance; // 1 - cosine similarity, in [0, 2]
+    };
+
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    HnswIndex() = default;
+    HnswIndex(std::size_t dimension, std::size_t capacity, const HnswParameters& parameters = HnswParameters());
+
+    std::size_t dimension() const { return dims; }
+    std::size_t capacity() const { return maxCount; }
+    std::size_t size() const { return nodeCount.load(std::memory_order_acquire); }
+    const HnswParameters& parameters() const { return params; }
+
+    // The stored, normalized copy of vector id.
+    const float* vector(std::size_t id) const { return data.data() + (id * dims); }
+
+    void setEfSearch(std::size_t ef) { params.efSearch = ef; }
+
+    // Adds one vector of dimension() floats and returns its id. Thread safe.
+    std::size_t add(const float* vector);
+
+    // Adds count vectors stored back to back, in parallel. They get consecutive ids starting
+    // at the returned one. The graph depends on the order the threads happen to insert in.
+    std::size_t addBatch(const float* vectors, std::size_t count);
+
+    // k approximate nearest neighbors of query, nearest first.
+    void search(const float* query, std::size_t k, std::vector<Result>& out) const;
+
+    // queryCount queries stored back to back, run in parallel. Query q writes its k results
+    // to out[q * k] onwards; missing results are {npos, infinity}.
+    void searchBatch(const float* queries, std::size_t queryCount, std::size_t k, Result* out) const;
+
+    // Binary format in native byte order: a header, then per node its level, its vector and
+    // its links. Both throw std::runtime_error on I/O errors; load() also on a bad header.
+    // load() replaces the whole index and leaves room for at least capacity nodes.
+    void save(const std::string& path) const;
+    void load(const std::string& path, std::size_t capacity = 0);
+
+private:
+    using Candidate = std::pair<float, std::uint32_t>; // (distance, id)
+
+    static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+    std::size_t dims = 0;
+    std::size_t maxCount = 0;
+    HnswParameters params;
+    const BatchKernels* kernels = nullptr;
+
+    std::atomic<std::size_t> nodeCount{ 0 };
+    std::vector<float> data;                            // normalized vectors, dims floats each
+    std::vector<std::uint8_t> levels;                   // top level of each node
+    std::vector<std::uint32_t> baseLinks;               // level 0: per node a count and 2M ids
+    std::vector<std::vector<std::uint32_t>> upperLinks; // levels 1 and up: a count and M ids each
+
+    std::unique_ptr<std::mutex[]> nodeLocks;
+    std::mutex entryLock; // guards entryPoint and maxLevel while inserting
+    std::uint32_t entryPoint = none;
+    int maxLevel = -1;
+
+    void allocate(std::size_t capacity);
+    void insert(std::uint32_t id, const float* vector);
+    int randomLevel(std::uint32_t id) const;
+
+    std::size_t maxLinks(int level) const { return level == 0 ? 2 * params.M : params.M; }
+    std::uint32_t* links(std::uint32_t id, int level);
+    const std::uint32_t* links(std::uint32_t id, int level) const;
+
+    float distance(const float* a, const float* b) const { return 1.0f - kernels->dotProductF32(a, b, dims); }
+
+    template <bool Locked>
+    std::uint32_t greedyClosest(const float* query, std::uint32_t start, int level) const;
+    template <bool Locked>
+    void searchLevel(const float* query, std::uint32_t start, std::size_t ef, int level, std::vector<Candidate>& found) const;
+
+    void selectNeighbors(std::vector<Candidate>& candidates, std::size_t count) const;
+    void connect(std::uint32_t node, std::uint32_t neighbor, int level);
+};
+
+// Recall@k against exact brute-force results, plus throughput of both at the current
+// efSearch. Both sides run in parallel over the queries.
+struct HnswReport
+{
+    double recall;
+    double queriesPerSecond;
+    double bruteForceQueriesPerSecond;
+};
+
+HnswReport evaluateRecall(const HnswIndex& index, const float* queries, std::size_t queryCount, std::size_t k);
@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cassert>
+#include <memory_resource>
+
+#include "arena.hpp"
+#include "kdtree.hpp"
+#include "parallel.hpp"
+
+KdTree::KdTree(const Vector3DBatch& points, std::size_t leafSize)
+{
+    build(points, leafSize);
+}
+
+void KdTree::build(const Vector3DBatch& points, std::size_t leafSize)
+{
+    assert(points.size() < std::numeric_limits<std::uint32_t>::max());
+    this->leafSize = std::max<std::size_t>(leafSize, 1);
+    std::size_t count = points.size();
+
+    nodes.clear();
+    pointIndex.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+        pointIndex[i] = static_cast<std::uint32_t>(i);
+
+    if (count > 0)
+    {
+        // The top levels split breadth first, one parallelFor per level over its nodes, until
+        // there is a subtree per worker thread; those are disjoint and built in parallel too.
+        nodes.resize(subtreeNodeCount(count));
+        ArenaScope scratch;
+        std::pmr::vector<Subtree> level(&scratch.arena()), next(&scratch.arena());
+        level.push_back({ 0, 0, count });
+        while (level.size() < workerThreadCount())
+        {
+            std::pmr::vector<std::size_t> middles(level.size(), &scratch.arena());
+            parallelFor(level.size(), 1, [&](std::size_t first, std::size_t last) {
+                for (std::size_t i = first; i < last; ++i)
+                    middles[i] = splitNode(points, level[i].node, level[i].begin, level[i].end);
+            });
+            next.clear();
+            for (std::size_t i = 0; i < level.size(); ++i)
+            {
+                const Subtree& subtree = level[i];
+                if (middles[i] == subtree.end)
+                    continue; // a leaf, already complete
+                next.push_back({ subtree.node + 1, subtree.begin, middles[i] });
+                next.push_back({ nodes[subtree.node].right, middles[i], subtree.end });
+            }
+            level.swap(next);
+            if (level.empty())
+                break;
+        }
+        parallelFor(level.size(), 1, [&](std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i < last; ++i)
+                buildSubtree(points, level[i].node, level[i].begin, level[i].end);
+        });
+    }
+
+    // Copy the points in tree order so leaves are contiguous.
+    pointX.resize(count);
+    pointY.resize(count);
+    pointZ.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        pointX[i] = points.x()[pointIndex[i]];
+        pointY[i] = points.y()[pointIndex[i]];
+        pointZ[i] = points.z()[pointIndex[i]];
+    }
+}
+
+std::size_t KdTree::subtreeNodeCount(std::size_t count) const
+{
+    if (count <= leafSize)
+        return 1;
+    std::size_t half = count / 2;
+    return 1 + subtreeNodeCount(half) + subtreeNodeCount(count - half);
+}
+
+std::size_t KdTree::splitNode(const Vector3DBatch& points, std::size_t nodeIndex, std::size_t begin, std::size_t end)
+{
+    Node& node = nodes[nodeIndex];
+    node.begin = static_cast<std::uint32_t>(begin);
+    node.end = static_cast<std::uint32_t>(end);
+    node.right = 0;
+    node.axis = 0;
+    node.split = 0.0;
+
+    std::size_t count = end - begin;
+    if (count <= leafSize)
+        return end;
+
+    // Split along the axis with the widest spread.
+    Vector3D low = points[pointIndex[begin]];
+    Vector3D high = low;
+    for (std::size_t i = begin + 1; i < end; ++i)
+    {
+        Vector3D p = points[pointIndex[i]];
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            low[axis] = std::min(low[axis], p[axis]);
+            high[axis] = std::max(high[axis], p[axis]);
+        }
+    }
+    Vector3D extent = high - low;
+    std::uint32_t axis = 0;
+    if (extent.y > extent[axis])
+        axis = 1;
+    if (extent.z > extent[axis])
+        axis = 2;
+
+    const double* coordinates = points.component(axis);
+    std::size_t middle = begin + (count / 2);
+    std::nth_element(pointIndex.begin() + begin, pointIndex.begin() + middle, pointIndex.begin() + end,
+                     [coordinates](std::uint32_t a, std::uint32_t b) { return coordinates[a] < coordinates[b]; });
+
+    std::size_t left = nodeIndex + 1;
+    std::size_t right = left + subtreeNodeCount(middle - begin);
+    node.axis = axis;
+    node.split = coordinates[pointIndex[middle]];
+    node.right = static_cast<std::uint32_t>(right);
+    return middle;
+}
+
+void KdTree::buildSubtree(const Vector3DBatch& points, std::size_t nodeIndex, std::size_t begin, std::size_t end)
+{
+    std::size_t middle = splitNode(points, nodeIndex, begin, end);
+    if (middle == end)
+        return;
+    buildSubtree(points, nodeIndex + 1, begin, middle);
+    buildSubtree(points, nodes[nodeIndex].right, middle, end);
+}
+
+void KdTree::nearest(const Vector3D& query, std::size_t k, std::vector<Neighbor>& out) const
+{
+    out.clear();
+    if (k == 0 || nodes.empty())
+        return;
+
+    // out is kept as a max-heap of the best k so far; worst is the pruning distance.
+    auto closer = [](const Neighbor& a, const Neighbor& b) { return a.distanceSquared < b.distanceSquared; };
+    double worst = std::numeric_limits<double>::infinity();
+
+    struct Pending
+    {
+        std::uint32_t node;
+        double distanceSquared; // lower bound for points in the subtree
+    };
+    Pending stack[64];
+    std::size_t top = 0;
+    stack[top++] = { 0, 0.0 };
+
+    while (top > 0)
+    {
+        Pending pending = stack[--top];
+        if (pending.distanceSquared > worst)
+            continue;
+
+        const Node& node = nodes[pending.node];
+        if (node.right == 0)
+        {
+            for (std::size_t i = node.begin; i < node.end; ++i)
+            {
+                double dx = pointX[i] - query.x, dy = pointY[i] - query.y, dz = pointZ[i] - query.z;
+                double distanceSquared = (dx * dx) + (dy * dy) + (dz * dz);
+                if (out.size() < k)
+                {
+                    out.push_back({ pointIndex[i], distanceSquared });
+                    std::push_heap(out.begin(), out.end(), closer);
+                }
+                else if (distanceSquared < out.front().distanceSquared)
+                {
+                    std::pop_heap(out.begin(), out.end(), closer);
+                    out.back() = { pointIndex[i], distanceSquared };
+                    std::push_heap(out.begin(), out.end(), closer);
+                }
+                if (out.size() == k)
+                    worst = out.front().distanceSquared;
+            }
+            continue;
+        }
+
+        // Visit the side containing the query first; the other side is at least the
+        // distance to the splitting plane away.
+        double offset = query[node.axis] - node.split;
+        std::uint32_t nearChild = offset < 0.0 ? pending.node + 1 : node.right;
+        std::uint32_t farChild = offset < 0.0 ? node.right : pending.node + 1;
+        stack[top++] = { farChild, std::max(pending.distanceSquared, offset * offset) };
+        stack[top++] = { nearChild, pending.distanceSquared };
+    }
+
+    std::sort_heap(out.begin(), out.end(), closer);
+}
+
+void KdTree::withinRadius(const Vector3D& query, double radius, std::vector<Neighbor>& out) const
+{
+    out.clear();
+    if (nodes.empty())
+        return;
+
+    const double radiusSquared = radius * radius;
+    std::uint32_t stack[64];
+    std::size_t top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node& node = nodes[stack[--top]];
+        if (node.right == 0)
+        {
+            for (std::size_t i = node.begin; i < node.end; ++i)
+            {
+                double dx = pointX[i] - query.x, dy = pointY[i] - query.y, dz = pointZ[i] - query.z;
+                double distanceSquared = (dx * dx) + (dy * dy) + (dz * dz);
+                if (distanceSquared <= radiusSquared)
+                    out.push_back({ pointIndex[i], distanceSquared });
+            }
+            continue;
+        }
+
+        std::uint32_t left = static_cast<std::uint32_t>(&node - nodes.data()) + 1;
+        double offset = query[node.axis] - node.split;
+        if (offset <= radius)
+            stack[top++] = left;
+        if (offset >= -radius)
+            stack[top++] = node.right;
+    }
+}
+
+void KdTree::nearestBatch(const Vector3DBatch& queries, std::size_t k, Neighbor* out) const
+{
+    parallelFor(queries.size(), 256, [&](std::size_t begin, std::size_t end) {
+        std::vector<Neighbor> found;
+        found.reserve(k);
+        for (std::size_t q = begin; q < end; ++q)
+        {
+            nearest(queries[q], k, found);
+            Neighbor* row = out + (q * k);
+            std::copy(found.begin(), found.end(), row);
+            std::fill(row + found.size(), row + k, Neighbor{ npos, std::numeric_limits<double>::infinity() });
+        }
+    });
+}
+
+void KdTree::withinRadiusBatch(const Vector3DBatch& queries, double radius, std::vector<std::vector<Neighbor>>& out) const
+{
+    out.resize(queries.size());
+    parallelFor(queries.size(), 256, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t q = begin; q < end; ++q)
+            withinRadius(queries[q], radius, out[q]);
+    });
+}
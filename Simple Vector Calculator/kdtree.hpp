@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "vector.hpp"
+#include "vector_batch.hpp"
+
+// Static KD-tree over a set of 3D points for k-nearest-neighbor and radius queries.
+//
+// Nodes live in one flat array in depth-first order: the left child of node i is i + 1 and
+// only the right child's index is stored. Points are copied in tree order into their own
+// x/y/z arrays, so each leaf is a short contiguous range that is scanned like a small batch.
+// Subtrees split at the middle element along the widest axis, which makes the node count of
+// every subtree known up front and lets the build fill disjoint subtrees in parallel.
+class KdTree
+{
+public:
+    struct Neighbor
+    {
+        std::size_t index;      // position in the batch the tree was built from
+        double distanceSquared;
+    };
+
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    KdTree() = default;
+    explicit KdTree(const Vector3DBatch& points, std::size_t leafSize = 16);
+
+    void build(const Vector3DBatch& points, std::size_t leafSize = 16);
+    std::size_t size() const { return pointX.size(); }
+
+    // k nearest points, nearest first. Returns fewer than k if the tree is smaller.
+    void nearest(const Vector3D& query, std::size_t k, std::vector<Neighbor>& out) const;
+
+    // Every point within radius of query (inclusive), in no particular order.
+    void withinRadius(const Vector3D& query, double radius, std::vector<Neighbor>& out) const;
+
+    // Batched queries, run in parallel. Query q writes its k neighbors to out[q * k] onwards,
+    // nearest first; missing neighbors are {npos, infinity}. out must hold queries.size() * k.
+    void nearestBatch(const Vector3DBatch& queries, std::size_t k, Neighbor* out) const;
+    void withinRadiusBatch(const Vector3DBatch& queries, double radius, std::vector<std::vector<Neighbor>>& out) const;
+
+private:
+    struct Node
+    {
+        double split;        // splitting coordinate (inner nodes)
+        std::uint32_t begin; // point range [begin, end) in tree order
+        std::uint32_t end;
+        std::uint32_t right; // right child index, 0 for leaves
+        std::uint32_t axis;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<double> pointX, pointY, pointZ; // points in tree order
+    std::vector<std::uint32_t> pointIndex;      // tree order -> original index
+    std::size_t leafSize = 16;
+
+    // A node still to be built: its index and point range.
+    struct Subtree
+    {
+        std::size_t node;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    std::size_t subtreeNodeCount(std::size_t count) const;
+    // Fills nodes[nodeIndex] and returns where its right child's points start, or end for a leaf.
+    std::size_t splitNode(const Vector3DBatch& points, std::size_t nodeIndex, std::size_t begin, std::size_t end);
+    void buildSubtree(const Vector3DBatch& points, std::size_t nodeIndex, std::size_t begin, std::size_t end);
+};
@@ -72,6 +72,24 @@ void processResult(int userSelection);
 void plotVectors(vectorInput& firstVector, vectorInput& secondVector);
 void ClearScreen();
 
+// Apply an operation to the 2D or 3D vectors held by the inputs. The dimension is only
+// checked once here; the operation itself is compiled separately for each vector type.
+template <typename Op>
+selectionResult::ResultType applyToVector(const vectorInput& v, Op op)
+{
+    if (v.is3D)
+        return op(v.vector3D_);
+    return op(v.vector2D_);
+}
+
+template <typename Op>
+selectionResult::ResultType applyToVectors(const vectorInput& v1, const vectorInput& v2, Op op)
+{
+    if (v1.is3D)
+        return op(v1.vector3D_, v2.vector3D_);
+    return op(v1.vector2D_, v2.vector2D_);
+}
+
 // Main program entry point
 int main()
 {
@@ -200,10 +218,7 @@ selectionResult performSelection(int userSelection)
 
         if (!resultant.errFlag.first)
         {
-            if (firstVector.is3D)
-                resultant.resultant = firstVector.vector3D_ + secondVector.vector3D_;
-            else
-                resultant.resultant = firstVector.vector2D_ + secondVector.vector2D_;
+            resultant.resultant = applyToVectors(firstVector, secondVector, [](const auto& a, const auto& b) { return a + b; });
         }
         break;
     }
@@ -219,10 +234,7 @@ selectionResult performSelection(int userSelection)
 
         if (!resultant.errFlag.first)
         {
-            if (firstVector.is3D)
-                resultant.resultant = firstVector.vector3D_ - secondVector.vector3D_;
-            else
-                resultant.resultant = firstVector.vector2D_ - secondVector.vector2D_;
+            resultant.resultant = applyToVectors(firstVector, secondVector, [](const auto& a, const auto& b) { return a - b; });
         }
         break;
     }
@@ -235,10 +247,7 @@ selectionResult performSelection(int userSelection)
 
         scalar = readScalar(); // Get scalar
 
-        if (firstVector.is3D)
-            resultant.resultant = firstVector.vector3D_ * scalar;
-        else
-            resultant.resultant = firstVector.vector2D_ * scalar;
+        resultant.resultant = applyToVector(firstVector, [scalar](const auto& v) { return v * scalar; });
 
         break;
     }
@@ -254,10 +263,7 @@ selectionResult performSelection(int userSelection)
 
         if (!resultant.errFlag.first)
         {
-            if (firstVector.is3D)
-                resultant.resultant = firstVector.vector3D_.dotProduct(secondVector.vector3D_);
-            else
-                resultant.resultant = firstVector.vector2D_.dotProduct(secondVector.vector2D_);
+            resultant.resultant = applyToVectors(firstVector, secondVector, [](const auto& a, const auto& b) { return a.dotProduct(b); });
         }
         break;
     }
@@ -288,10 +294,7 @@ selectionResult performSelection(int userSelection)
         std::getline(std::cin, line);
         firstVector = readVector(line);
 
-        if (firstVector.is3D)
-            resultant.resultant = firstVector.vector3D_.magnitude();
-        else
-            resultant.resultant = firstVector.vector2D_.magnitude();
+        resultant.resultant = applyToVector(firstVector, [](const auto& v) { return v.magnitude(); });
 
         break;
     }
@@ -306,10 +309,7 @@ selectionResult performSelection(int userSelection)
         }
         else
         {
-            if (firstVector.is3D)
-                resultant.resultant = firstVector.vector3D_.angleBetween(secondVector.vector3D_);
-            else
-                resultant.resultant = firstVector.vector2D_.angleBetween(secondVector.vector2D_);
+            resultant.resultant = applyToVectors(firstVector, secondVector, [](const auto& a, const auto& b) { return a.angleBetween(b); });
         }
         break;
     }
@@ -0,0 +1,292 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numbers>
+#include <utility>
+
+#include "vector.hpp"
+
+// 3x3 and 4x4 matrices for transforming Vector3 values. Both are row-major and act on column
+// vectors, so m * v transforms v and (a * b) * v == a * (b * v): b is applied first.
+
+template <typename T>
+class Matrix3
+{
+public:
+    using value_type = T;
+
+    // Zero matrix; see identity().
+    constexpr Matrix3() = default;
+
+    constexpr Matrix3(const Vector3<T>& row0, const Vector3<T>& row1, const Vector3<T>& row2)
+    {
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            m[0][c] = row0[c];
+            m[1][c] = row1[c];
+            m[2][c] = row2[c];
+        }
+    }
+
+    static constexpr Matrix3 identity()
+    {
+        return scale(Vector3<T>(T(1), T(1), T(1)));
+    }
+
+    static constexpr Matrix3 scale(const Vector3<T>& factors)
+    {
+        Matrix3 result;
+        for (std::size_t i = 0; i < 3; ++i)
+            result.m[i][i] = factors[i];
+        return result;
+    }
+
+    // Right-handed rotation by angle about axis; axis need not be normalized.
+    static Matrix3 rotation(const Vector3<T>& axis, T angle, AngleUnit unit = AngleUnit::Degrees)
+    {
+        if (unit == AngleUnit::Degrees)
+            angle *= std::numbers::pi_v<T> / T(180);
+        Vector3<T> u = axis.normalize();
+        T c = std::cos(angle);
+        T s = std::sin(angle);
+        T t = T(1) - c;
+        return Matrix3(Vector3<T>((t * u.x * u.x) + c, (t * u.x * u.y) - (s * u.z), (t * u.x * u.z) + (s * u.y)),
+                       Vector3<T>((t * u.x * u.y) + (s * u.z), (t * u.y * u.y) + c, (t * u.y * u.z) - (s * u.x)),
+                       Vector3<T>((t * u.x * u.z) - (s * u.y), (t * u.y * u.z) + (s * u.x), (t * u.z * u.z) + c));
+    }
+
+    static constexpr Matrix3 fromColumns(const Vector3<T>& column0, const Vector3<T>& column1, const Vector3<T>& column2)
+    {
+        return Matrix3(column0, column1, column2).transpose();
+    }
+
+    // Right-handed orthonormal basis with columns tangent, bitangent and normal (normalized),
+    // built without branches after Duff et al., "Building an Orthonormal Basis, Revisited"
+    // (2017). The tangent is continuous in the normal except where normal.z changes sign.
+    static Matrix3 orthonormalBasis(const Vector3<T>& normal)
+    {
+        Vector3<T> n = normal.normalize();
+        T sign = std::copysign(T(1), n.z);
+        T a = T(-1) / (sign + n.z);
+        T b = n.x * n.y * a;
+        return fromColumns(Vector3<T>(T(1) + (sign * n.x * n.x * a), sign * b, -sign * n.x),
+                           Vector3<T>(b, sign + (n.y * n.y * a), -n.y), n);
+    }
+
+    // Right-handed orthonormal frame with columns tangent, bitangent and normal, where the
+    // tangent is the given one made perpendicular to the normal (Gram-Schmidt). A tangent that
+    // is zero or within about 1e-6 radians of the normal gives orthonormalBasis(normal).
+    static Matrix3 orthonormalFrame(const Vector3<T>& normal, const Vector3<T>& tangent)
+    {
+        Vector3<T> n = normal.normalize();
+        Vector3<T> bitangent = n.crossProduct(tangent);
+        if (!(bitangent.magnitudeSquared() > T(1e-12) * tangent.magnitudeSquared()))
+            return orthonormalBasis(n);
+        bitangent = bitangent.normalize();
+        return fromColumns(bitangent.crossProduct(n), bitangent, n);
+    }
+
+    constexpr T& operator()(std::size_t row, std::size_t column) { return m[row][column]; }
+    constexpr const T& operator()(std::size_t row, std::size_t column) const { return m[row][column]; }
+
+    constexpr Vector3<T> row(std::size_t r) const { return Vector3<T>(m[r][0], m[r][1], m[r][2]); }
+    constexpr Vector3<T> column(std::size_t c) const { return Vector3<T>(m[0][c], m[1][c], m[2][c]); }
+
+    constexpr Vector3<T> operator*(const Vector3<T>& v) const
+    {
+        return Vector3<T>(row(0).dotProduct(v), row(1).dotProduct(v), row(2).dotProduct(v));
+    }
+
+    constexpr Matrix3 operator*(const Matrix3& other) const
+    {
+        Matrix3 result;
+        for (std::size_t r = 0; r < 3; ++r)
+        {
+            for (std::size_t c = 0; c < 3; ++c)
+                result.m[r][c] = row(r).dotProduct(other.column(c));
+        }
+        return result;
+    }
+
+    constexpr Matrix3 transpose() const
+    {
+        return Matrix3(column(0), column(1), column(2));
+    }
+
+    constexpr T determinant() const
+    {
+        return row(0).dotProduct(row(1).crossProduct(row(2)));
+    }
+
+    // The inverse of a singular matrix is not finite; check determinant() first if unsure.
+    constexpr Matrix3 inverse() const
+    {
+        // Rows of the adjugate's transpose are cross products of the rows.
+        Vector3<T> c0 = row(1).crossProduct(row(2));
+        Vector3<T> c1 = row(2).crossProduct(row(0));
+        Vector3<T> c2 = row(0).crossProduct(row(1));
+        T inverseDeterminant = T(1) / row(0).dotProduct(c0);
+        return Matrix3(c0 * inverseDeterminant, c1 * inverseDeterminant, c2 * inverseDeterminant).transpose();
+    }
+
+private:
+    T m[3][3]{};
+};
+
+// Eigen decomposition of a symmetric 3x3 matrix: matrix = vectors * diag(values) * vectors^T.
+template <typename T>
+struct SymmetricEigen3
+{
+    Vector3<T> values;  // largest first
+    Matrix3<T> vectors; // column i is the unit eigenvector of values[i]; a right-handed rotation
+};
+
+// Cyclic Jacobi rotations, which converge quadratically and give eigenvectors orthogonal to
+// rounding even for repeated eigenvalues. Only the upper triangle of matrix is read.
+template <typename T>
+SymmetricEigen3<T> symmetricEigen(const Matrix3<T>& matrix)
+{
+    Matrix3<T> a;
+    for (std::size_t r = 0; r < 3; ++r)
+    {
+        for (std::size_t c = r; c < 3; ++c)
+            a(r, c) = a(c, r) = matrix(r, c);
+    }
+    Matrix3<T> v = Matrix3<T>::identity();
+
+    constexpr std::pair<std::size_t, std::size_t> pairs[3] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+    constexpr T epsilon = std::numeric_limits<T>::epsilon();
+    for (int sweep = 0; sweep < 32; ++sweep)
+    {
+        T offDiagonal = (a(0, 1) * a(0, 1)) + (a(0, 2) * a(0, 2)) + (a(1, 2) * a(1, 2));
+        T diagonal = (a(0, 0) * a(0, 0)) + (a(1, 1) * a(1, 1)) + (a(2, 2) * a(2, 2));
+        if (!(offDiagonal > epsilon * epsilon * diagonal))
+            break;
+        for (auto [p, q] : pairs)
+        {
+            if (a(p, q) == T(0))
+                continue;
+            // Rotation in the (p, q) plane that zeroes a(p, q), by the smaller of the two angles.
+            T theta = (a(q, q) - a(p, p)) / (T(2) * a(p, q));
+            T t = std::copysign(T(1), theta) / (std::abs(theta) + std::sqrt((theta * theta) + T(1)));
+            T c = T(1) / std::sqrt((t * t) + T(1));
+            T s = t * c;
+            for (std::size_t k = 0; k < 3; ++k)
+            {
+                T kp = a(k, p), kq = a(k, q);
+                a(k, p) = (c * kp) - (s * kq);
+                a(k, q) = (s * kp) + (c * kq);
+            }
+            for (std::size_t k = 0; k < 3; ++k)
+            {
+                T pk = a(p, k), qk = a(q, k);
+                a(p, k) = (c * pk) - (s * qk);
+                a(q, k) = (s * pk) + (c * qk);
+            }
+            a(p, q) = a(q, p) = T(0);
+            for (std::size_t k = 0; k < 3; ++k)
+            {
+                T kp = v(k, p), kq = v(k, q);
+                v(k, p) = (c * kp) - (s * kq);
+                v(k, q) = (s * kp) + (c * kq);
+            }
+        }
+    }
+
+    std::size_t order[3] = { 0, 1, 2 };
+    std::sort(order, order + 3, [&](std::size_t i, std::size_t j) { return a(i, i) > a(j, j); });
+    SymmetricEigen3<T> result;
+    Vector3<T> columns[3];
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        result.values[i] = a(order[i], order[i]);
+        columns[i] = v.column(order[i]);
+    }
+    if (columns[0].crossProduct(columns[1]).dotProduct(columns[2]) < T(0))
+        columns[2] = columns[2] * T(-1);
+    result.vectors = Matrix3<T>::fromColumns(columns[0], columns[1], columns[2]);
+    return result;
+}
+
+// Affine 4x4 transform: a linear part plus a translation, bottom row 0 0 0 1. Points get the
+// translation, directions do not.
+template <typename T>
+class Matrix4
+{
+public:
+    using value_type = T;
+
+    // Zero linear part and no translation; see identity().
+    constexpr Matrix4()
+    {
+        m[3][3] = T(1);
+    }
+
+    explicit constexpr Matrix4(const Matrix3<T>& linear, const Vector3<T>& translation = Vector3<T>())
+    {
+        for (std::size_t r = 0; r < 3; ++r)
+        {
+            for (std::size_t c = 0; c < 3; ++c)
+                m[r][c] = linear(r, c);
+            m[r][3] = translation[r];
+        }
+        m[3][3] = T(1);
+    }
+
+    static constexpr Matrix4 identity()
+    {
+        return Matrix4(Matrix3<T>::identity());
+    }
+
+    static constexpr Matrix4 fromTranslation(const Vector3<T>& offset)
+    {
+        return Matrix4(Matrix3<T>::identity(), offset);
+    }
+
+    constexpr T& operator()(std::size_t row, std::size_t column) { return m[row][column]; }
+    constexpr const T& operator()(std::size_t row, std::size_t column) const { return m[row][column]; }
+
+    constexpr Matrix3<T> linear() const
+    {
+        return Matrix3<T>(Vector3<T>(m[0][0], m[0][1], m[0][2]),
+                          Vector3<T>(m[1][0], m[1][1], m[1][2]),
+                          Vector3<T>(m[2][0], m[2][1], m[2][2]));
+    }
+
+    constexpr Vector3<T> translation() const { return Vector3<T>(m[0][3], m[1][3], m[2][3]); }
+
+    constexpr Vector3<T> transformPoint(const Vector3<T>& p) const { return (linear() * p) + translation(); }
+    constexpr Vector3<T> transformDirection(const Vector3<T>& d) const { return linear() * d; }
+
+    constexpr Matrix4 operator*(const Matrix4& other) const
+    {
+        return Matrix4(linear() * other.linear(), transformPoint(other.translation()));
+    }
+
+    // Inverse of the affine transform; the linear part must be invertible.
+    constexpr Matrix4 inverse() const
+    {
+        Matrix3<T> inverseLinear = linear().inverse();
+        return Matrix4(inverseLinear, (inverseLinear * translation()) * T(-1));
+    }
+
+    // Row-major 3x4 copy (the bottom row is implied), the layout the batch kernels take.
+    constexpr void affineRows(T* out) const
+    {
+        for (std::size_t r = 0; r < 3; ++r)
+        {
+            for (std::size_t c = 0; c < 4; ++c)
+                out[(r * 4) + c] = m[r][c];
+        }
+    }
+
+private:
+    T m[4][4]{};
+};
+
+using Matrix3D = Matrix3<double>;
+using Matrix4D = Matrix4<double>;
+using Matrix3f = Matrix3<float>;
+using Matrix4f = Matrix4<float>;
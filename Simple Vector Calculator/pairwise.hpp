@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+#include "vector_batch.hpp"
+
+// All-pairs products between two sets of 3D vectors. Row i, column j of the result is the
+// value for a[i] and b[j]. The work is split into cache-sized tiles of rows x columns that
+// run in parallel, and each row of a tile is computed with the SIMD batch kernels.
+
+// Dense row-major a.size() x b.size() matrices; out must hold a.size() * b.size() doubles.
+void pairwiseDotProduct(const Vector3DBatch& a, const Vector3DBatch& b, double* out);
+void pairwiseDistanceSquared(const Vector3DBatch& a, const Vector3DBatch& b, double* out);
+void pairwiseDistance(const Vector3DBatch& a, const Vector3DBatch& b, double* out);
+
+// One tile of the result matrix: rows x cols values, row-major with a stride of cols.
+// values is only valid during the callback.
+struct PairwiseTile
+{
+    std::size_t rowBegin;
+    std::size_t colBegin;
+    std::size_t rows;
+    std::size_t cols;
+    const double* values;
+};
+
+using PairwiseTileCallback = std::function<void(const PairwiseTile&)>;
+
+// Streaming variants for results too large to store: every tile is passed to callback
+// exactly once, in no particular order. The callback runs concurrently on the worker
+// threads, so it must be thread safe.
+void pairwiseDotProductTiles(const Vector3DBatch& a, const Vector3DBatch& b, const PairwiseTileCallback& callback);
+void pairwiseDistanceSquaredTiles(const Vector3DBatch& a, const Vector3DBatch& b, const PairwiseTileCallback& callback);
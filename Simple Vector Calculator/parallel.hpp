@@ -0,0 +1,155 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace detail
+{
+    inline std::atomic<unsigned int>& workerThreadOverride()
+    {
+        static std::atomic<unsigned int> threads{ 0 };
+        return threads;
+    }
+}
+
+// Number of threads the parallel batch algorithms use by default: the hardware concurrency,
+// unless setWorkerThreadCount() chose another.
+inline unsigned int workerThreadCount()
+{
+    unsigned int threads = detail::workerThreadOverride().load(std::memory_order_relaxed);
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+// Overrides workerThreadCount(); 0 goes back to the hardware concurrency. Results of the
+// reductions do not depend on it, so this only trades speed, e.g. to leave cores free.
+inline void setWorkerThreadCount(unsigned int threads)
+{
+    detail::workerThreadOverride().store(threads, std::memory_order_relaxed);
+}
+
+// Threads that run parallelFor chunks next to the calling thread. They are started on first
+// use, as many as the largest call has asked for, and live until the program exits, so
+// their threadArena()s (arena.hpp) and other thread_local scratch space survive between
+// calls and a steady-state workload stops allocating on them too.
+//
+// Several threads may submit jobs at once, and a job may submit nested jobs from its body:
+// the submitting thread always works on its own job and only waits for helpers that joined
+// it, so a job finishes even when every pool thread is busy elsewhere.
+class WorkerPool
+{
+public:
+    struct Job
+    {
+        void (*run)(void* context);
+        void* context;
+        unsigned int helpersWanted;    // pool threads that may still join
+        unsigned int helpersActive = 0;
+    };
+
+    static WorkerPool& instance()
+    {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Runs job.run(job.context) on the calling thread and on up to job.helpersWanted pool
+    // threads, and returns once all of them are done. run must not throw.
+    void run(Job& job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (threads.size() < job.helpersWanted)
+                threads.emplace_back([this] { work(); });
+            queue.push_back(&job);
+        }
+        wake.notify_all();
+        job.run(job.context);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        queue.erase(std::remove(queue.begin(), queue.end(), &job), queue.end());
+        finished.wait(lock, [&] { return job.helpersActive == 0; });
+    }
+
+private:
+    WorkerPool() = default;
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            Job* job = queue.front();
+            if (--job->helpersWanted == 0)
+                queue.erase(queue.begin());
+            ++job->helpersActive;
+            lock.unlock();
+            job->run(job->context);
+            lock.lock();
+            if (--job->helpersActive == 0)
+                finished.notify_all();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;     // a job was queued, or the pool is stopping
+    std::condition_variable finished; // a job lost its last helper
+    std::vector<Job*> queue;          // jobs that still take helpers, oldest first
+    std::vector<std::thread> threads;
+    bool stopping = false;
+};
+
+// Runs body(begin, end) over [0, count) in chunks of at most grain items. Chunks are handed
+// out dynamically to up to maxThreads threads (0 = workerThreadCount()), the calling thread
+// and WorkerPool threads, and the call returns once every chunk is done. body must not throw.
+template <typename F>
+void parallelFor(std::size_t count, std::size_t grain, F body, unsigned int maxThreads = 0)
+{
+    if (count == 0)
+        return;
+    grain = std::max<std::size_t>(grain, 1);
+    std::size_t chunks = (count + grain - 1) / grain;
+    unsigned int threads = maxThreads == 0 ? workerThreadCount() : maxThreads;
+    threads = static_cast<unsigned int>(std::min<std::size_t>(threads, chunks));
+
+    if (threads <= 1)
+    {
+        for (std::size_t begin = 0; begin < count; begin += grain)
+            body(begin, std::min(begin + grain, count));
+        return;
+    }
+
+    std::atomic<std::size_t> nextChunk{ 0 };
+    auto worker = [&]() {
+        for (std::size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++)
+        {
+            std::size_t begin = chunk * grain;
+            body(begin, std::min(begin + grain, count));
+        }
+    };
+
+    WorkerPool::Job job{ [](void* context) { (*static_cast<decltype(worker)*>(context))(); }, &worker, threads - 1 };
+    WorkerPool::instance().run(job);
+}
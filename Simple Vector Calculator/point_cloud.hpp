@@ -0,0 +1,242 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <memory_resource>
+
+#include "arena.hpp"
+#include "batch_reduce.hpp"
+#include "bounding_box.hpp"
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "vector.hpp"
+#include "vector_batch.hpp"
+#include "vector_simd.hpp"
+
+// Covariance, principal axes and oriented bounding boxes of 3D point clouds.
+//
+// Covariance is accumulated as a count, a mean and the sums of products of deviations from
+// the mean (co-moments). Accumulators merge exactly (Chan, Golub and LeVeque), so a cloud
+// can be streamed through in pieces of any size, on any number of threads, and combined at
+// the end; covariance() of a batch does the same over reductionChunkSize chunks.
+
+template <typename T>
+struct CovarianceAccumulator
+{
+    std::size_t count = 0;
+    Vector3<T> mean;
+    T comoments[6]{}; // xx, xy, xz, yy, yz, zz
+
+    // Welford's update for a single point.
+    void add(const Vector3<T>& point)
+    {
+        ++count;
+        Vector3<T> before = point - mean;
+        mean += before * (T(1) / static_cast<T>(count));
+        Vector3<T> after = point - mean;
+        comoments[0] += before.x * after.x;
+        comoments[1] += before.x * after.y;
+        comoments[2] += before.x * after.z;
+        comoments[3] += before.y * after.y;
+        comoments[4] += before.y * after.z;
+        comoments[5] += before.z * after.z;
+    }
+
+    void merge(const CovarianceAccumulator& other)
+    {
+        if (other.count == 0)
+            return;
+        if (count == 0)
+        {
+            *this = other;
+            return;
+        }
+        T total = static_cast<T>(count + other.count);
+        Vector3<T> delta = other.mean - mean;
+        T weight = static_cast<T>(count) * static_cast<T>(other.count) / total;
+        mean += delta * (static_cast<T>(other.count) / total);
+        comoments[0] += other.comoments[0] + (delta.x * delta.x * weight);
+        comoments[1] += other.comoments[1] + (delta.x * delta.y * weight);
+        comoments[2] += other.comoments[2] + (delta.x * delta.z * weight);
+        comoments[3] += other.comoments[3] + (delta.y * delta.y * weight);
+        comoments[4] += other.comoments[4] + (delta.y * delta.z * weight);
+        comoments[5] += other.comoments[5] + (delta.z * delta.z * weight);
+        count += other.count;
+    }
+
+    // Accumulator of count points given their sums about origin: sums[0..2] of d = p - origin
+    // and sums[3..8] of the products of d in comoments order. With origin one of the points
+    // the sums stay small, which keeps the conversion from cancelling.
+    static CovarianceAccumulator fromMoments(std::size_t count, const Vector3<T>& origin, const T* sums)
+    {
+        CovarianceAccumulator result;
+        if (count == 0)
+            return result;
+        T inverseCount = T(1) / static_cast<T>(count);
+        Vector3<T> offset(sums[0] * inverseCount, sums[1] * inverseCount, sums[2] * inverseCount);
+        result.count = count;
+        result.mean = origin + offset;
+        result.comoments[0] = sums[3] - (sums[0] * offset.x);
+        result.comoments[1] = sums[4] - (sums[0] * offset.y);
+        result.comoments[2] = sums[5] - (sums[0] * offset.z);
+        result.comoments[3] = sums[6] - (sums[1] * offset.y);
+        result.comoments[4] = sums[7] - (sums[1] * offset.z);
+        result.comoments[5] = sums[8] - (sums[2] * offset.z);
+        return result;
+    }
+
+    // Population covariance (co-moments / count); the zero matrix before any point.
+    Matrix3<T> matrix() const
+    {
+        T scale = count == 0 ? T(0) : T(1) / static_cast<T>(count);
+        return Matrix3<T>(Vector3<T>(comoments[0], comoments[1], comoments[2]) * scale,
+                          Vector3<T>(comoments[1], comoments[3], comoments[4]) * scale,
+                          Vector3<T>(comoments[2], comoments[4], comoments[5]) * scale);
+    }
+};
+
+using CovarianceAccumulatorD = CovarianceAccumulator<double>;
+
+// One pass over the batch: each chunk sums its moments about its first point (the SIMD
+// moments3 kernel for doubles) and the chunk accumulators are merged in chunk order.
+template <typename T>
+CovarianceAccumulator<T> covariance(const VectorBatch<T, 3>& batch)
+{
+    ArenaScope scratch;
+    std::pmr::vector<CovarianceAccumulator<T>> partials((batch.size() + reductionChunkSize - 1) / reductionChunkSize, &scratch.arena());
+    parallelFor(batch.size(), reductionChunkSize, [&](std::size_t begin, std::size_t end) {
+        Vector3<T> origin = batch[begin];
+        T sums[9]{};
+        if constexpr (VectorBatch<T, 3>::hasSimdKernels)
+        {
+            const double o[3] = { origin.x, origin.y, origin.z };
+            batchKernels().moments3(o, batch.x() + begin, batch.y() + begin, batch.z() + begin, end - begin, sums);
+        }
+        else
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                T dx = batch.x()[i] - origin.x, dy = batch.y()[i] - origin.y, dz = batch.z()[i] - origin.z;
+                sums[0] += dx;
+                sums[1] += dy;
+                sums[2] += dz;
+                sums[3] += dx * dx;
+                sums[4] += dx * dy;
+                sums[5] += dx * dz;
+                sums[6] += dy * dy;
+                sums[7] += dy * dz;
+                sums[8] += dz * dz;
+            }
+        }
+        partials[begin / reductionChunkSize] = CovarianceAccumulator<T>::fromMoments(end - begin, origin, sums);
+    });
+
+    CovarianceAccumulator<T> result;
+    for (const CovarianceAccumulator<T>& partial : partials)
+        result.merge(partial);
+    return result;
+}
+
+// Principal component analysis: the eigenvectors of the covariance, by decreasing variance.
+template <typename T>
+struct PrincipalAxes
+{
+    Vector3<T> center;    // the mean
+    Matrix3<T> axes;      // column i is the i-th principal axis; a right-handed rotation
+    Vector3<T> variances; // variance along each axis, largest first
+};
+
+template <typename T>
+PrincipalAxes<T> principalAxes(const CovarianceAccumulator<T>& accumulator)
+{
+    SymmetricEigen3<T> eigen = symmetricEigen(accumulator.matrix());
+    return { accumulator.mean, eigen.vectors, eigen.values };
+}
+
+template <typename T>
+PrincipalAxes<T> principalAxes(const VectorBatch<T, 3>& batch)
+{
+    return principalAxes(covariance(batch));
+}
+
+// Box with edges along the columns of axes, center + axes * local for local in
+// [-halfExtents, halfExtents].
+template <typename T>
+struct OrientedBox
+{
+    Vector3<T> center;
+    Matrix3<T> axes = Matrix3<T>::identity();
+    Vector3<T> halfExtents;
+
+    // Oriented box from a box in the frame of axes, e.g. from localBounds.
+    static OrientedBox fromLocal(const Matrix3<T>& axes, const BoundingBox<T, 3>& local)
+    {
+        OrientedBox result;
+        result.axes = axes;
+        if (local.isEmpty())
+            return result;
+        result.center = axes * local.center();
+        result.halfExtents = local.extent() * T(0.5);
+        return result;
+    }
+
+    bool contains(const Vector3<T>& point) const
+    {
+        Vector3<T> local = axes.transpose() * (point - center);
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            if (std::abs(local[i]) > halfExtents[i])
+                return false;
+        }
+        return true;
+    }
+
+    T volume() const { return T(8) * halfExtents.x * halfExtents.y * halfExtents.z; }
+};
+
+using OrientedBoxD = OrientedBox<double>;
+
+// Bounds of the batch in the frame of the orthonormal axes (coordinates axes^T p). Boxes of
+// pieces of a cloud in the same frame merge with BoundingBox::grow.
+template <typename T>
+BoundingBox<T, 3> localBounds(const VectorBatch<T, 3>& batch, const Matrix3<T>& axes)
+{
+    T rows[12];
+    Matrix4<T>(axes.transpose()).affineRows(rows);
+    ArenaScope scratch;
+    std::pmr::vector<BoundingBox<T, 3>> partials((batch.size() + reductionChunkSize - 1) / reductionChunkSize, &scratch.arena());
+    parallelFor(batch.size(), reductionChunkSize, [&](std::size_t begin, std::size_t end) {
+        BoundingBox<T, 3>& partial = partials[begin / reductionChunkSize];
+        std::size_t count = end - begin;
+        if constexpr (VectorBatch<T, 3>::hasSimdKernels)
+        {
+            // Rotate the chunk into a scratch buffer, then take its range per axis.
+            ArenaScope chunkScratch;
+            std::pmr::vector<T> local(3 * count, &chunkScratch.arena());
+            const BatchKernels& kernels = batchKernels();
+            kernels.transform3(rows, batch.x() + begin, batch.y() + begin, batch.z() + begin,
+                               local.data(), local.data() + count, local.data() + (2 * count), count);
+            for (std::size_t axis = 0; axis < 3; ++axis)
+                kernels.minMax(local.data() + (axis * count), count, &partial.low[axis], &partial.high[axis]);
+        }
+        else
+        {
+            Matrix3<T> inverse = axes.transpose();
+            for (std::size_t i = begin; i < end; ++i)
+                partial.grow(inverse * batch[i]);
+        }
+    });
+
+    BoundingBox<T, 3> result;
+    for (const BoundingBox<T, 3>& partial : partials)
+        result.grow(partial);
+    return result;
+}
+
+// Box along the principal axes holding every point. Two passes over the batch: covariance,
+// then localBounds. Not the minimum-volume box, but close to it for elongated clouds.
+template <typename T>
+OrientedBox<T> orientedBoundingBox(const VectorBatch<T, 3>& batch)
+{
+    Matrix3<T> axes = principalAxes(batch).axes;
+    return OrientedBox<T>::fromLocal(axes, localBounds(batch, axes));
+}
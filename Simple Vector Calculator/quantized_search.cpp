@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <memory_resource>
+
+#include "arena.hpp"
+#include "parallel.hpp"
+#include "quantized_search.hpp"
+#include "search_common.hpp"
+#include "vector_simd.hpp"
+
+namespace
+{
+    using Result = QuantizedSearch::Result;
+
+    using detail::better;
+    using detail::normalizeInto;
+    using detail::offer;
+
+    // Offset and scale mapping [low, high] onto codes [-127, 127].
+    void signedRange(float low, float high, float& offset, float& scale)
+    {
+        offset = 0.5f * (low + high);
+        scale = (high - low) / 254.0f;
+    }
+
+    std::int8_t signedCode(float value, float offset, float scale)
+    {
+        float code = scale > 0.0f ? std::round((value - offset) / scale) : 0.0f;
+        return static_cast<std::int8_t>(std::clamp(code, -127.0f, 127.0f));
+    }
+}
+
+QuantizedSearch::QuantizedSearch(std::size_t dimension, QuantizationMode mode, bool keepVectors)
+    : dims(dimension), quantization(mode), keepCopies(keepVectors)
+{
+    assert(dimension > 0 && dimension <= 65536); // keeps byte dot products exact in 32 bits
+    if (quantization == QuantizationMode::PerDimension)
+    {
+        offsets.assign(dims, 0.0f);
+        scales.assign(dims, 1.0f / 127.0f);
+    }
+}
+
+void QuantizedSearch::reserve(std::size_t capacity)
+{
+    codes.reserve(capacity * dims);
+    codeSums.reserve(capacity);
+    if (quantization == QuantizationMode::PerVector)
+    {
+        offsets.reserve(capacity);
+        scales.reserve(capacity);
+    }
+    if (keepCopies)
+        copies.reserve(capacity * dims);
+}
+
+std::size_t QuantizedSearch::bytesPerVector() const
+{
+    std::size_t bytes = dims * sizeof(std::int8_t) + sizeof(std::int32_t);
+    if (quantization == QuantizationMode::PerVector)
+        bytes += 2 * sizeof(float);
+    if (keepCopies)
+        bytes += dims * sizeof(std::uint16_t);
+    return bytes;
+}
+
+void QuantizedSearch::train(const float* samples, std::size_t sampleCount)
+{
+    assert(quantization == QuantizationMode::PerDimension && count == 0);
+    if (sampleCount == 0)
+        return;
+    const BatchKernels& kernels = batchKernels();
+    ArenaScope scratch;
+    std::pmr::vector<float> low(dims, std::numeric_limits<float>::infinity(), &scratch.arena());
+    std::pmr::vector<float> high(dims, -std::numeric_limits<float>::infinity(), &scratch.arena());
+    std::pmr::vector<float> unit(dims, &scratch.arena());
+    for (std::size_t s = 0; s < sampleCount; ++s)
+    {
+        normalizeInto(kernels, samples + (s * dims), unit.data(), dims);
+        for (std::size_t axis = 0; axis < dims; ++axis)
+        {
+            low[axis] = std::min(low[axis], unit[axis]);
+            high[axis] = std::max(high[axis], unit[axis]);
+        }
+    }
+    for (std::size_t axis = 0; axis < dims; ++axis)
+        signedRange(low[axis], high[axis], offsets[axis], scales[axis]);
+}
+
+std::size_t QuantizedSearch::add(const float* vector)
+{
+    ArenaScope scratch;
+    std::pmr::vector<float> unit(dims, &scratch.arena());
+    normalizeInto(batchKernels(), vector, unit.data(), dims);
+
+    if (quantization == QuantizationMode::PerVector)
+    {
+        auto [low, high] = std::minmax_element(unit.begin(), unit.end());
+        float offset, scale;
+        signedRange(*low, *high, offset, scale);
+        offsets.push_back(offset);
+        scales.push_back(scale);
+    }
+    std::int32_t sum = 0;
+    for (std::size_t axis = 0; axis < dims; ++axis)
+    {
+        bool perVector = quantization == QuantizationMode::PerVector;
+        std::int8_t code = signedCode(unit[axis], perVector ? offsets.back() : offsets[axis], perVector ? scales.back() : scales[axis]);
+        codes.push_back(code);
+        sum += code;
+    }
+    codeSums.push_back(sum);
+    if (keepCopies)
+    {
+        copies.resize((count + 1) * dims);
+        batchKernels().narrowF16(unit.data(), copies.data() + (count * dims), dims);
+    }
+    return count++;
+}
+
+QuantizedSearch::EncodedQuery QuantizedSearch::encode(const float* query, std::pmr::memory_resource* resource) const
+{
+    EncodedQuery encoded{ std::pmr::vector<float>(dims, resource), std::pmr::vector<std::uint8_t>(dims, resource) };
+    normalizeInto(batchKernels(), query, encoded.unit.data(), dims);
+
+    // The scan needs sum(w[axis] * code[axis]): w is the query itself, or the query times
+    // the dimension scales with the offsets folded into the constant.
+    std::pmr::vector<float> weights(encoded.unit, resource);
+    for (std::size_t axis = 0; axis < dims; ++axis)
+    {
+        if (quantization == QuantizationMode::PerVector)
+        {
+            encoded.constant += encoded.unit[axis];
+        }
+        else
+        {
+            encoded.constant += encoded.unit[axis] * offsets[axis];
+            weights[axis] *= scales[axis];
+        }
+    }
+
+    // Unsigned codes over the weights' own range: w ~ offset + scale * [0, 255].
+    auto [low, high] = std::minmax_element(weights.begin(), weights.end());
+    encoded.offset = *low;
+    encoded.scale = (*high - *low) / 255.0f;
+    for (std::size_t axis = 0; axis < dims; ++axis)
+    {
+        float code = encoded.scale > 0.0f ? std::round((weights[axis] - encoded.offset) / encoded.scale) : 0.0f;
+        encoded.codes[axis] = static_cast<std::uint8_t>(std::clamp(code, 0.0f, 255.0f));
+    }
+    return encoded;
+}
+
+float QuantizedSearch::score(const EncodedQuery& query, std::size_t id, std::int32_t codeDot) const
+{
+    // sum(w * code) ~ sum((offset + scale * queryCode) * code).
+    float weighted = (query.offset * static_cast<float>(codeSums[id])) + (query.scale * static_cast<float>(codeDot));
+    if (quantization == QuantizationMode::PerVector)
+        return (offsets[id] * query.constant) + (scales[id] * weighted);
+    return query.constant + weighted;
+}
+
+float QuantizedSearch::similarity(const float* query, std::size_t id) const
+{
+    assert(id < count);
+    ArenaScope scratch;
+    EncodedQuery encoded = encode(query, &scratch.arena());
+    return score(encoded, id, batchKernels().dotProductU8I8(encoded.codes.data(), codes.data() + (id * dims), dims));
+}
+
+float QuantizedSearch::similarityErrorBound(const float* query, std::size_t id) const
+{
+    assert(id < count);
+    ArenaScope scratch;
+    EncodedQuery encoded = encode(query, &scratch.arena());
+    bool perVector = quantization == QuantizationMode::PerVector;
+    const std::int8_t* vectorCodes = codes.data() + (id * dims);
+    float storedError = 0.0f;
+    float codeMagnitude = 0.0f;
+    for (std::size_t axis = 0; axis < dims; ++axis)
+    {
+        storedError += std::abs(encoded.unit[axis]) * (perVector ? scales[id] : scales[axis]);
+        codeMagnitude += static_cast<float>(std::abs(vectorCodes[axis]));
+    }
+    return 0.5f * (storedError + (encoded.scale * codeMagnitude * (perVector ? scales[id] : 1.0f)));
+}
+
+void QuantizedSearch::scan(const EncodedQuery& query, std::size_t begin, std::size_t end, std::size_t keep,
+                           std::pmr::vector<Result>& heap) const
+{
+    const BatchKernels& kernels = batchKernels();
+    float threshold = -std::numeric_limits<float>::infinity();
+    for (std::size_t id = begin; id < end; ++id)
+    {
+        float s = score(query, id, kernels.dotProductU8I8(query.codes.data(), codes.data() + (id * dims), dims));
+        if (s >= threshold)
+        {
+            offer(heap, keep, { id, s });
+            if (heap.size() == keep)
+                threshold = heap.front().similarity;
+        }
+    }
+}
+
+void QuantizedSearch::finish(const EncodedQuery& query, std::pmr::vector<Result>& candidates, std::size_t k, bool rescore,
+                             Result* out) const
+{
+    if (rescore)
+    {
+        const BatchKernels& kernels = batchKernels();
+        std::pmr::vector<float> widened(dims, candidates.get_allocator().resource());
+        for (Result& candidate : candidates)
+        {
+            kernels.widenF16(copies.data() + (candidate.id * dims), widened.data(), dims);
+            candidate.similarity = kernels.dotProductF32(query.unit.data(), widened.data(), dims);
+        }
+    }
+    std::size_t found = std::min(k, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + found, candidates.end(), better);
+    std::copy(candidates.begin(), candidates.begin() + found, out);
+    std::fill(out + found, out + k, Result{ npos, -std::numeric_limits<float>::infinity() });
+}
+
+void QuantizedSearch::search(const float* query, std::size_t k, std::vector<Result>& out, std::size_t rerank) const
+{
+    out.resize(k);
+    searchBatch(query, 1, k, out.data(), rerank);
+    out.resize(std::min(k, count));
+}
+
+void QuantizedSearch::searchBatch(const float* queries, std::size_t queryCount, std::size_t k, Result* out,
+                                  std::size_t rerank) const
+{
+    if (queryCount == 0 || k == 0)
+        return;
+    bool rescore = keepCopies && rerank > 0;
+    std::size_t keep = rescore ? k * rerank : k;
+
+    if (queryCount == 1)
+    {
+        // One query: split the vectors over the threads, one heap each, merged at the end.
+        // Each heap is reserved up front from the calling thread's arena and never grows.
+        ArenaScope scratch;
+        EncodedQuery encoded = encode(queries, &scratch.arena());
+        constexpr std::size_t minimumPerThread = 4096;
+        unsigned int threads = static_cast<unsigned int>(
+            std::clamp<std::size_t>(count / minimumPerThread, 1, workerThreadCount()));
+        std::pmr::vector<std::pmr::vector<Result>> heaps(threads, &scratch.arena());
+        for (std::pmr::vector<Result>& heap : heaps)
+            heap.reserve(keep);
+        parallelFor(threads, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t thread = begin; thread < end; ++thread)
+                scan(encoded, (count * thread) / threads, (count * (thread + 1)) / threads, keep, heaps[thread]);
+        }, threads);
+
+        std::pmr::vector<Result> merged(&scratch.arena());
+        for (const std::pmr::vector<Result>& heap : heaps)
+            merged.insert(merged.end(), heap.begin(), heap.end());
+        std::size_t candidates = std::min(keep, merged.size());
+        std::partial_sort(merged.begin(), merged.begin() + candidates, merged.end(), better);
+        merged.resize(candidates);
+        finish(encoded, merged, k, rescore, out);
+        return;
+    }
+
+    // Several queries: one thread per query at a time, each scanning everything.
+    parallelFor(queryCount, 1, [&](std::size_t begin, std::size_t end) {
+        ArenaScope scratch;
+        std::pmr::vector<Result> heap(&scratch.arena());
+        heap.reserve(keep);
+        for (std::size_t q = begin; q < end; ++q)
+        {
+            ArenaScope queryScratch;
+            EncodedQuery encoded = encode(queries + (q * dims), &queryScratch.arena());
+            heap.clear();
+            scan(encoded, 0, count, keep, heap);
+            finish(encoded, heap, k, rescore, out + (q * k));
+        }
+    });
+}
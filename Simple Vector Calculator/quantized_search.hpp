@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <vector>
+
+// How QuantizedSearch turns a component into a signed byte code, with
+// component ~ offset + scale * code and code in [-127, 127].
+//   PerVector     offset and scale from the range of each vector's own components. Needs no
+//                 training and adapts to every vector; costs two floats per vector.
+//   PerDimension  one offset and scale per dimension, shared by all vectors, from train()
+//                 (by default [-1, 1], the range of a unit vector's components). Better when
+//                 dimensions have very different ranges, as in many embedding models.
+enum class QuantizationMode
+{
+    PerVector,
+    PerDimension
+};
+
+// Approximate top-k cosine similarity search over int8 scalar-quantized vectors, with an
+// optional re-ranking pass against 16-bit copies.
+//
+// Vectors are normalized, as in CosineSearch, and stored as one signed byte per component: a
+// quarter of the memory of float and an eighth of double, so a scan streams that much less.
+// A query is quantized to unsigned bytes over its own range, and its similarity to a stored
+// vector is one byte dot product (BatchKernels::dotProductU8I8, VNNI where the CPU has it)
+// plus a few per-vector corrections for the offsets and scales: an approximation of the dot
+// product of the two unit vectors.
+//
+// With keepVectors = true the unit vectors are also kept in IEEE half precision (half.hpp),
+// and the best rerank * k vectors of the scan are scored again against those, in float,
+// which recovers most of the recall the byte rounding loses. Memory per vector of d
+// components, bytesPerVector():
+//   d + 12 bytes     PerVector, codes plus code sum, offset and scale (768-d: 3.9x less than
+//                    float, 7.9x less than double)
+//   d + 4 bytes      PerDimension, plus 8 bytes per dimension for the whole index
+//   + 2d bytes       with keepVectors, a copy that is still half the size of float
+class QuantizedSearch
+{
+public:
+    struct Result
+    {
+        std::size_t id;
+        float similarity; // cosine similarity, approximate unless re-ranked
+    };
+
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    explicit QuantizedSearch(std::size_t dimension, QuantizationMode mode = QuantizationMode::PerVector, bool keepVectors = false);
+
+    std::size_t dimension() const { return dims; }
+    std::size_t size() const { return count; }
+    QuantizationMode mode() const { return quantization; }
+    bool keepsVectors() const { return keepCopies; }
+    std::size_t bytesPerVector() const;
+    void reserve(std::size_t capacity);
+
+    // PerDimension only, before the first add(): the offset and scale of every dimension from
+    // the range of count sample vectors of dimension() floats, stored back to back. Samples
+    // are normalized first, like stored vectors; later components outside the range clamp.
+    void train(const float* vectors, std::size_t sampleCount);
+
+    // Adds a vector of dimension() floats and returns its id; ids are consecutive from 0.
+    std::size_t add(const float* vector);
+
+    // Approximate cosine similarity of query and vector id, from the codes alone.
+    float similarity(const float* query, std::size_t id) const;
+
+    // How far similarity(query, id) can be from the exact cosine similarity. Rounding moves
+    // each stored component u[i] by at most half its step s[i] and each query weight by half
+    // the query step t, so the error is at most (sum |q[i]| s[i] + t sum |c[i] v|) / 2, with q
+    // the unit query, c the vector's codes and v its scale (PerVector) or 1 (PerDimension),
+    // up to float rounding of the sums. In PerDimension mode it holds for vectors whose unit
+    // components lie inside the trained ranges; components outside were clamped.
+    float similarityErrorBound(const float* query, std::size_t id) const;
+
+    // The k most similar vectors to query, most similar first; ties go to the lower id. The
+    // best rerank * k scan results are re-scored against the half precision copies when they
+    // are kept; rerank 0, or no copies, returns the scan scores.
+    void search(const float* query, std::size_t k, std::vector<Result>& out, std::size_t rerank = 4) const;
+
+    // queryCount queries stored back to back. Query q writes its k results to out[q * k]
+    // onwards; missing results are {npos, -infinity}.
+    void searchBatch(const float* queries, std::size_t queryCount, std::size_t k, Result* out, std::size_t rerank = 4) const;
+
+private:
+    // A query as the scan uses it, with unit ~ offset + scale * codes per component (after
+    // the per-dimension scales in PerDimension mode).
+    struct EncodedQuery
+    {
+        std::pmr::vector<float> unit;
+        std::pmr::vector<std::uint8_t> codes;
+        float offset = 0.0f;
+        float scale = 0.0f;
+        float constant = 0.0f; // sum of unit (PerVector) or of unit * offsets (PerDimension)
+    };
+
+    EncodedQuery encode(const float* query, std::pmr::memory_resource* resource) const;
+    float score(const EncodedQuery& query, std::size_t id, std::int32_t codeDot) const;
+    void scan(const EncodedQuery& query, std::size_t begin, std::size_t end, std::size_t keep, std::pmr::vector<Result>& heap) const;
+    void finish(const EncodedQuery& query, std::pmr::vector<Result>& candidates, std::size_t k, bool rescore, Result* out) const;
+
+    std::size_t dims;
+    QuantizationMode quantization;
+    bool keepCopies;
+    std::size_t count = 0;
+    std::vector<std::int8_t> codes;     // codes[id * dims + axis]
+    std::vector<float> offsets;         // per vector (PerVector) or per dimension (PerDimension)
+    std::vector<float> scales;          // likewise
+    std::vector<std::int32_t> codeSums; // sum of each vector's codes
+    std::vector<std::uint16_t> copies;  // normalized copies in half precision, if kept
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <cmath>
+#include <numbers>
+
+#include "matrix.hpp"
+#include "vector.hpp"
+
+// Rotation quaternion w + xi + yj + zk. Stored x, y, z, w: the same order as a Vector4 or
+// the components of a VectorBatch<T, 4>, which is how batches of quaternions are kept.
+// Rotations compose like matrices: (a * b).rotate(v) == a.rotate(b.rotate(v)).
+template <typename T>
+struct Quaternion
+{
+    using value_type = T;
+
+    T x = T(0), y = T(0), z = T(0), w = T(1);
+
+    // The identity rotation.
+    constexpr Quaternion() = default;
+    constexpr Quaternion(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
+    explicit constexpr Quaternion(const Vector4<T>& v) : x(v.x), y(v.y), z(v.z), w(v.w) {}
+
+    // Right-handed rotation by angle about axis; axis need not be normalized.
+    static Quaternion fromAxisAngle(const Vector3<T>& axis, T angle, AngleUnit unit = AngleUnit::Degrees)
+    {
+        if (unit == AngleUnit::Degrees)
+            angle *= std::numbers::pi_v<T> / T(180);
+        Vector3<T> u = axis.normalize() * std::sin(angle / T(2));
+        return Quaternion(u.x, u.y, u.z, std::cos(angle / T(2)));
+    }
+
+    constexpr Vector3<T> vector() const { return Vector3<T>(x, y, z); }
+    constexpr Vector4<T> toVector4() const { return Vector4<T>(x, y, z, w); }
+
+    // Hamilton product.
+    constexpr Quaternion operator*(const Quaternion& other) const
+    {
+        return Quaternion((w * other.x) + (x * other.w) + (y * other.z) - (z * other.y),
+                          (w * other.y) - (x * other.z) + (y * other.w) + (z * other.x),
+                          (w * other.z) + (x * other.y) - (y * other.x) + (z * other.w),
+                          (w * other.w) - (x * other.x) - (y * other.y) - (z * other.z));
+    }
+
+    constexpr Quaternion conjugate() const { return Quaternion(-x, -y, -z, w); }
+
+    constexpr T normSquared() const { return (x * x) + (y * y) + (z * z) + (w * w); }
+    T norm() const { return std::sqrt(normSquared()); }
+
+    constexpr Quaternion inverse() const
+    {
+        T scale = T(1) / normSquared();
+        return Quaternion(-x * scale, -y * scale, -z * scale, w * scale);
+    }
+
+    // A zero quaternion normalizes to the identity rather than NaN.
+    Quaternion normalize() const
+    {
+        T n = norm();
+        if (!(n > T(0)))
+            return Quaternion();
+        return Quaternion(x / n, y / n, z / n, w / n);
+    }
+
+    // Rotates v by a unit quaternion: v + 2w(q x v) + 2q x (q x v), without building a matrix.
+    constexpr Vector3<T> rotate(const Vector3<T>& v) const
+    {
+        Vector3<T> q = vector();
+        Vector3<T> t = q.crossProduct(v) * T(2);
+        return v + (t * w) + q.crossProduct(t);
+    }
+
+    // Rotation matrix of a unit quaternion. Cheaper than rotate() once more than a couple
+    // of vectors share the rotation.
+    constexpr Matrix3<T> toMatrix3() const
+    {
+        T xx = x * x, yy = y * y, zz = z * z;
+        T xy = x * y, xz = x * z, yz = y * z;
+        T wx = w * x, wy = w * y, wz = w * z;
+        return Matrix3<T>(Vector3<T>(T(1) - (T(2) * (yy + zz)), T(2) * (xy - wz), T(2) * (xz + wy)),
+                          Vector3<T>(T(2) * (xy + wz), T(1) - (T(2) * (xx + zz)), T(2) * (yz - wx)),
+                          Vector3<T>(T(2) * (xz - wy), T(2) * (yz + wx), T(1) - (T(2) * (xx + yy))));
+    }
+};
+
+using QuaternionD = Quaternion<double>;
+using QuaternionF = Quaternion<float>;
@@ -0,0 +1,49 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "vector_simd.hpp"
+
+// Pieces shared by the similarity searches (CosineSearch, QuantizedSearch, HnswIndex). Only
+// their .cpp files include this.
+namespace detail
+{
+    // Orders {id, similarity} results best first: higher similarity, then lower id.
+    struct BetterResult
+    {
+        template <typename Result>
+        bool operator()(const Result& a, const Result& b) const
+        {
+            return a.similarity > b.similarity || (a.similarity == b.similarity && a.id < b.id);
+        }
+    };
+
+    inline constexpr BetterResult better{};
+
+    // Keeps the best k results offered so far in a heap with the worst one on top.
+    template <typename Heap>
+    void offer(Heap& heap, std::size_t k, const typename Heap::value_type& result)
+    {
+        if (heap.size() < k)
+        {
+            heap.push_back(result);
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+        else if (better(result, heap.front()))
+        {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = result;
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+
+    // Copies vector to out scaled to unit length; a zero vector stays zero.
+    inline void normalizeInto(const BatchKernels& kernels, const float* vector, float* out, std::size_t dims)
+    {
+        float lengthSquared = kernels.dotProductF32(vector, vector, dims);
+        float scale = lengthSquared > 0.0f ? 1.0f / std::sqrt(lengthSquared) : 0.0f;
+        for (std::size_t i = 0; i < dims; ++i)
+            out[i] = vector[i] * scale;
+    }
+}
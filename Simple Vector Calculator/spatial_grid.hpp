@@ -0,0 +1,249 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <vector>
+
+#include "arena.hpp"
+#include "parallel.hpp"
+#include "vector.hpp"
+#include "vector_batch.hpp"
+
+// Uniform grid for fixed-radius neighbor searches over 2D or 3D points.
+//
+// Space is cut into cubes of cellSize, and each cell is hashed into a table of buckets,
+// so memory scales with the number of points rather than with the extent of the data. The
+// build is a counting sort in two passes, every step of it under parallelFor: points are
+// hashed, then split by the top bits of their bucket into at most 256 partitions through a
+// histogram per chunk of points, then each partition, a contiguous range of buckets, is
+// counting sorted on its own. The result is one contiguous array of points per bucket, plus
+// offsets, with the points of a bucket in index order whatever the thread count. Buffers are
+// kept between builds, so rebuilding every frame does not allocate once the sizes settle.
+//
+// With cellSize equal to the search radius, a query only visits the 3^N cells around it.
+// Different cells can share a bucket; every candidate is distance checked, so that only
+// costs time. Queries take their scratch space from threadArena() (arena.hpp).
+template <typename T, std::size_t N>
+class SpatialGrid
+{
+public:
+    SpatialGrid() = default;
+
+    void build(const VectorBatch<T, N>& points, T cellSize)
+    {
+        assert(cellSize > T(0));
+        assert(points.size() < std::numeric_limits<std::uint32_t>::max());
+        this->cellSize = cellSize;
+        inverseCellSize = T(1) / cellSize;
+
+        std::size_t count = points.size();
+        std::size_t tableSize = 1;
+        while (tableSize < count)
+            tableSize <<= 1;
+        tableMask = tableSize - 1;
+        bucketStart.resize(tableSize + 1);
+
+        pointBucket.resize(count);
+        parallelFor(count, chunkSize, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                pointBucket[i] = bucketOf(cellOf(points[i]));
+        });
+
+        // Pass 1: partition p holds buckets [p << shift, (p + 1) << shift). Each chunk counts
+        // its points per partition; a prefix sum over (partition, chunk) then gives every chunk
+        // its own output range in each partition, so the chunks scatter independently.
+        std::size_t partitions = std::min(tableSize, maxPartitions);
+        int shift = std::countr_zero(tableSize / partitions);
+        std::size_t chunks = (count + chunkSize - 1) / chunkSize;
+        chunkOffsets.assign(chunks * partitions, 0);
+        parallelFor(count, chunkSize, [&](std::size_t begin, std::size_t end) {
+            std::uint32_t* histogram = chunkOffsets.data() + ((begin / chunkSize) * partitions);
+            for (std::size_t i = begin; i < end; ++i)
+                ++histogram[pointBucket[i] >> shift];
+        });
+        partitionStart.resize(partitions + 1);
+        std::uint32_t running = 0;
+        for (std::size_t p = 0; p < partitions; ++p)
+        {
+            partitionStart[p] = running;
+            for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+            {
+                std::uint32_t& offset = chunkOffsets[(chunk * partitions) + p];
+                std::uint32_t chunkPoints = offset;
+                offset = running;
+                running += chunkPoints;
+            }
+        }
+        partitionStart[partitions] = running;
+
+        partitionOrder.resize(count);
+        parallelFor(count, chunkSize, [&](std::size_t begin, std::size_t end) {
+            std::uint32_t* cursor = chunkOffsets.data() + ((begin / chunkSize) * partitions);
+            for (std::size_t i = begin; i < end; ++i)
+                partitionOrder[cursor[pointBucket[i] >> shift]++] = static_cast<std::uint32_t>(i);
+        });
+
+        // Pass 2: a counting sort of each partition's points over its own buckets. Scatter with
+        // a running cursor per bucket, then shift the cursors back into bucket starts.
+        sortedIndex.resize(count);
+        sortedPoints.resize(count);
+        parallelFor(partitions, 1, [&](std::size_t firstPartition, std::size_t lastPartition) {
+            for (std::size_t p = firstPartition; p < lastPartition; ++p)
+            {
+                std::size_t firstBucket = p << shift;
+                std::size_t lastBucket = (p + 1) << shift;
+                std::fill(bucketStart.begin() + firstBucket, bucketStart.begin() + lastBucket, 0);
+                for (std::uint32_t slot = partitionStart[p]; slot < partitionStart[p + 1]; ++slot)
+                    ++bucketStart[pointBucket[partitionOrder[slot]]];
+                std::uint32_t start = partitionStart[p];
+                for (std::size_t b = firstBucket; b < lastBucket; ++b)
+                {
+                    std::uint32_t bucketPoints = bucketStart[b];
+                    bucketStart[b] = start;
+                    start += bucketPoints;
+                }
+
+                for (std::uint32_t order = partitionStart[p]; order < partitionStart[p + 1]; ++order)
+                {
+                    std::uint32_t i = partitionOrder[order];
+                    std::uint32_t slot = bucketStart[pointBucket[i]]++;
+                    sortedIndex[slot] = i;
+                    for (std::size_t axis = 0; axis < N; ++axis)
+                        sortedPoints.component(axis)[slot] = points.component(axis)[i];
+                }
+                for (std::size_t b = lastBucket - 1; b > firstBucket; --b)
+                    bucketStart[b] = bucketStart[b - 1];
+                bucketStart[firstBucket] = partitionStart[p];
+            }
+        });
+        bucketStart[tableSize] = static_cast<std::uint32_t>(count);
+    }
+
+    std::size_t size() const { return sortedIndex.size(); }
+
+    // Appends the index of every point within radius of center (inclusive). Radii larger
+    // than the cell size work, but visit (2 * ceil(radius / cellSize) + 1)^N cells.
+    void withinRadius(const VectorN<T, N>& center, T radius, std::vector<std::size_t>& out) const
+    {
+        if (sortedIndex.empty())
+            return;
+        const T radiusSquared = radius * radius;
+        std::int64_t reach = static_cast<std::int64_t>(std::ceil(radius * inverseCellSize));
+        ArenaScope scratch;
+        std::pmr::vector<std::uint32_t> buckets(&scratch.arena());
+        neighborBuckets(cellOf(center), reach, buckets);
+
+        for (std::uint32_t bucket : buckets)
+        {
+            for (std::uint32_t slot = bucketStart[bucket]; slot < bucketStart[bucket + 1]; ++slot)
+            {
+                if (slotDistanceSquared(slot, center) <= radiusSquared)
+                    out.push_back(sortedIndex[slot]);
+            }
+        }
+    }
+
+    // Calls pair(i, j) exactly once for every pair of distinct points at most radius apart.
+    // radius must not exceed the cell size.
+    template <typename F>
+    void forEachPairWithinRadius(T radius, F pair) const
+    {
+        assert(radius <= cellSize);
+        const T radiusSquared = radius * radius;
+        ArenaScope scratch;
+        std::pmr::vector<std::uint32_t> buckets(&scratch.arena());
+        buckets.reserve(maxNeighborCells);
+
+        // Each pair is reported from the point that comes first in bucket order.
+        for (std::uint32_t slot = 0; slot < sortedIndex.size(); ++slot)
+        {
+            VectorN<T, N> point = sortedPoints[slot];
+            neighborBuckets(cellOf(point), 1, buckets);
+            for (std::uint32_t bucket : buckets)
+            {
+                for (std::uint32_t other = std::max(bucketStart[bucket], slot + 1); other < bucketStart[bucket + 1]; ++other)
+                {
+                    if (slotDistanceSquared(other, point) <= radiusSquared)
+                        pair(static_cast<std::size_t>(sortedIndex[slot]), static_cast<std::size_t>(sortedIndex[other]));
+                }
+            }
+        }
+    }
+
+private:
+    using Cell = VectorN<double, N>; // integer cell coordinates, exact in a double
+
+    static constexpr std::size_t chunkSize = 1 << 14;
+    static constexpr std::size_t maxPartitions = 256;
+    static constexpr std::size_t maxNeighborCells = N == 2 ? 9 : 27; // 3^N
+
+    T cellSize = T(1);
+    T inverseCellSize = T(1);
+    std::size_t tableMask = 0;
+    std::vector<std::uint32_t> bucketStart; // bucket b holds slots [bucketStart[b], bucketStart[b + 1])
+    std::vector<std::uint32_t> pointBucket;
+    std::vector<std::uint32_t> chunkOffsets;   // build: per chunk and partition, the next output slot
+    std::vector<std::uint32_t> partitionStart; // build: partition p holds partitionOrder[partitionStart[p], ...)
+    std::vector<std::uint32_t> partitionOrder; // build: point indices grouped by partition
+    std::vector<std::uint32_t> sortedIndex; // slot -> original point index
+    VectorBatch<T, N> sortedPoints;         // points in slot order
+
+    Cell cellOf(const VectorN<T, N>& point) const
+    {
+        Cell cell;
+        for (std::size_t axis = 0; axis < N; ++axis)
+            cell[axis] = std::floor(static_cast<double>(point[axis] * inverseCellSize));
+        return cell;
+    }
+
+    std::uint32_t bucketOf(const Cell& cell) const
+    {
+        static const std::uint64_t primes[3] = { 73856093ull, 19349663ull, 83492791ull };
+        std::uint64_t hash = 0;
+        for (std::size_t axis = 0; axis < N; ++axis)
+            hash ^= static_cast<std::uint64_t>(static_cast<std::int64_t>(cell[axis])) * primes[axis % 3];
+        return static_cast<std::uint32_t>(hash & tableMask);
+    }
+
+    // Distinct buckets of every cell within reach cells of center along each axis.
+    void neighborBuckets(const Cell& center, std::int64_t reach, std::pmr::vector<std::uint32_t>& buckets) const
+    {
+        buckets.clear();
+        std::int64_t offsets[N];
+        std::fill(offsets, offsets + N, -reach);
+        while (true)
+        {
+            Cell cell = center;
+            for (std::size_t axis = 0; axis < N; ++axis)
+                cell[axis] += static_cast<double>(offsets[axis]);
+            buckets.push_back(bucketOf(cell));
+
+            std::size_t axis = 0;
+            while (axis < N && ++offsets[axis] > reach)
+                offsets[axis++] = -reach;
+            if (axis == N)
+                break;
+        }
+        std::sort(buckets.begin(), buckets.end());
+        buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+    }
+
+    T slotDistanceSquared(std::uint32_t slot, const VectorN<T, N>& point) const
+    {
+        T result = T(0);
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            T d = sortedPoints.component(axis)[slot] - point[axis];
+            result += d * d;
+        }
+        return result;
+    }
+};
+
+using SpatialGrid2D = SpatialGrid<double, 2>;
+using SpatialGrid3D = SpatialGrid<double, 3>;
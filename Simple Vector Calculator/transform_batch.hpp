@@ -0,0 +1,191 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory_resource>
+#include <utility>
+
+#include "matrix.hpp"
+#include "quaternion.hpp"
+#include "vector_batch.hpp"
+#include "vector_simd.hpp"
+
+// Transforms of whole batches of 3D vectors. Double batches use the SIMD kernels. out is
+// resized to fit and may be the same batch as in.
+
+// r = M p + t over a row-major 3x4 matrix [M | t].
+template <typename T>
+void transformAffine(const T* rows, const VectorBatch<T, 3>& in, VectorBatch<T, 3>& out)
+{
+    out.resize(in.size());
+    if constexpr (VectorBatch<T, 3>::hasSimdKernels)
+    {
+        batchKernels().transform3(rows, in.x(), in.y(), in.z(), out.x(), out.y(), out.z(), in.size());
+        return;
+    }
+    const T *x = in.x(), *y = in.y(), *z = in.z();
+    T *rx = out.x(), *ry = out.y(), *rz = out.z();
+    for (std::size_t i = 0; i < in.size(); ++i)
+    {
+        T px = x[i], py = y[i], pz = z[i];
+        rx[i] = (rows[0] * px) + (rows[1] * py) + (rows[2] * pz) + rows[3];
+        ry[i] = (rows[4] * px) + (rows[5] * py) + (rows[6] * pz) + rows[7];
+        rz[i] = (rows[8] * px) + (rows[9] * py) + (rows[10] * pz) + rows[11];
+    }
+}
+
+template <typename T>
+void transform(const Matrix3<T>& m, const VectorBatch<T, 3>& in, VectorBatch<T, 3>& out)
+{
+    T rows[12];
+    Matrix4<T>(m).affineRows(rows);
+    transformAffine(rows, in, out);
+}
+
+template <typename T>
+void transformPoints(const Matrix4<T>& m, const VectorBatch<T, 3>& in, VectorBatch<T, 3>& out)
+{
+    T rows[12];
+    m.affineRows(rows);
+    transformAffine(rows, in, out);
+}
+
+template <typename T>
+void transformDirections(const Matrix4<T>& m, const VectorBatch<T, 3>& in, VectorBatch<T, 3>& out)
+{
+    transform(m.linear(), in, out);
+}
+
+// Rotates every vector by one unit quaternion. The matrix is built once, so this is the
+// cost of a matrix transform rather than of Quaternion::rotate per element.
+template <typename T>
+void rotate(const Quaternion<T>& q, const VectorBatch<T, 3>& in, VectorBatch<T, 3>& out)
+{
+    transform(q.toMatrix3(), in, out);
+}
+
+// One 3x3 matrix per element, stored as nine arrays (structure of arrays, like VectorBatch),
+// e.g. the orientations of a set of bodies precomputed from their quaternions once per frame.
+// Storage comes from a std::pmr memory resource like VectorBatch's, so such per-frame batches
+// can live in an Arena (arena.hpp).
+template <typename T>
+class Matrix3Batch
+{
+public:
+    Matrix3Batch() = default;
+    explicit Matrix3Batch(std::size_t count) { resize(count); }
+
+    explicit Matrix3Batch(std::pmr::memory_resource* resource)
+        : elements(makeElements(resource, std::make_index_sequence<9>()))
+    {
+    }
+
+    Matrix3Batch(std::size_t count, std::pmr::memory_resource* resource) : Matrix3Batch(resource) { resize(count); }
+
+    std::size_t size() const { return elements[0].size(); }
+    std::pmr::memory_resource* resource() const { return elements[0].get_allocator().resource(); }
+
+    void resize(std::size_t count)
+    {
+        for (auto& element : elements)
+            element.resize(count);
+    }
+
+    Matrix3<T> operator[](std::size_t i) const
+    {
+        Matrix3<T> m;
+        for (std::size_t e = 0; e < 9; ++e)
+            m(e / 3, e % 3) = elements[e][i];
+        return m;
+    }
+
+    void set(std::size_t i, const Matrix3<T>& m)
+    {
+        for (std::size_t e = 0; e < 9; ++e)
+            elements[e][i] = m(e / 3, e % 3);
+    }
+
+    // Array of element (row, column) over the whole batch.
+    T* element(std::size_t row, std::size_t column) { return elements[(row * 3) + column].data(); }
+    const T* element(std::size_t row, std::size_t column) const { return elements[(row * 3) + column].data(); }
+
+    // Rotation matrices of a batch of unit quaternions stored x, y, z, w.
+    void assignRotations(const VectorBatch<T, 4>& quaternions)
+    {
+        resize(quaternions.size());
+        if constexpr (VectorBatch<T, 4>::hasSimdKernels)
+        {
+            batchKernels().quaternionToMatrix3(quaternions.component(0), quaternions.component(1), quaternions.component(2),
+                                               quaternions.component(3), pointers().data(), size());
+            return;
+        }
+        for (std::size_t i = 0; i < size(); ++i)
+            set(i, Quaternion<T>(quaternions[i]).toMatrix3());
+    }
+
+    // Matrix3::orthonormalBasis of every normal, in one fused pass for double batches.
+    void assignOrthonormalBases(const VectorBatch<T, 3>& normals)
+    {
+        resize(normals.size());
+        if constexpr (VectorBatch<T, 3>::hasSimdKernels)
+        {
+            batchKernels().orthonormalBasis3(normals.x(), normals.y(), normals.z(), pointers().data(), size());
+            return;
+        }
+        for (std::size_t i = 0; i < size(); ++i)
+            set(i, Matrix3<T>::orthonormalBasis(normals[i]));
+    }
+
+    // Matrix3::orthonormalFrame of every normal and tangent pair, e.g. the tangent frames of
+    // the vertices of a mesh, in one fused pass for double batches.
+    void assignOrthonormalFrames(const VectorBatch<T, 3>& normals, const VectorBatch<T, 3>& tangents)
+    {
+        assert(tangents.size() == normals.size());
+        resize(normals.size());
+        if constexpr (VectorBatch<T, 3>::hasSimdKernels)
+        {
+            batchKernels().orthonormalFrame3(normals.x(), normals.y(), normals.z(), tangents.x(), tangents.y(), tangents.z(),
+                                             pointers().data(), size());
+            return;
+        }
+        for (std::size_t i = 0; i < size(); ++i)
+            set(i, Matrix3<T>::orthonormalFrame(normals[i], tangents[i]));
+    }
+
+    // out[i] = (*this)[i] * in[i].
+    void transform(const VectorBatch<T, 3>& in, VectorBatch<T, 3>& out) const
+    {
+        assert(in.size() == size());
+        out.resize(size());
+        if constexpr (VectorBatch<T, 3>::hasSimdKernels)
+        {
+            std::array<const T*, 9> m;
+            for (std::size_t e = 0; e < 9; ++e)
+                m[e] = elements[e].data();
+            batchKernels().transform3Each(m.data(), in.x(), in.y(), in.z(), out.x(), out.y(), out.z(), size());
+            return;
+        }
+        for (std::size_t i = 0; i < size(); ++i)
+            out.set(i, (*this)[i] * in[i]);
+    }
+
+private:
+    std::array<std::pmr::vector<T>, 9> elements; // row-major: elements[row * 3 + column]
+
+    template <std::size_t... E>
+    static std::array<std::pmr::vector<T>, 9> makeElements(std::pmr::memory_resource* resource, std::index_sequence<E...>)
+    {
+        return { ((void)E, std::pmr::vector<T>(resource))... };
+    }
+
+    std::array<T*, 9> pointers()
+    {
+        std::array<T*, 9> result;
+        for (std::size_t e = 0; e < 9; ++e)
+            result[e] = elements[e].data();
+        return result;
+    }
+};
+
+using Matrix3DBatch = Matrix3Batch<double>;
+using Matrix3fBatch = Matrix3Batch<float>;
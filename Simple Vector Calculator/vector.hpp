@@ -1,36 +1,296 @@
 #pragma once
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <type_traits>
+#include <utility>
 
-class Vector2D
+// All members are defined inline so the compiler can fold and inline them in hot loops.
+// Everything except the sqrt/acos based methods is constexpr.
+
+// Unit for angleBetween results.
+enum class AngleUnit
 {
-public:
-    double x, y;
-
-    Vector2D();
-    Vector2D(double x, double y);
-
-    Vector2D operator+(const Vector2D& other) const;
-    Vector2D operator-(const Vector2D& other) const;
-    Vector2D operator*(double scalar) const;
-    double dotProduct(const Vector2D& other) const;
-    double magnitude() const;
-    double angleBetween(const Vector2D& other) const;
-    Vector2D normalize() const;
+    Degrees,
+    Radians
+};
+
+// Component storage. 2, 3 and 4 component vectors get named members (x, y, z, w),
+// larger vectors are stored as a plain array. Both can be indexed with operator[].
+template <typename T, std::size_t N>
+struct VectorStorage
+{
+    T data[N]{};
+
+    constexpr T& operator[](std::size_t i) { return data[i]; }
+    constexpr const T& operator[](std::size_t i) const { return data[i]; }
+};
+
+template <typename T>
+struct VectorStorage<T, 2>
+{
+    T x{}, y{};
+
+    constexpr T& operator[](std::size_t i) { return this->*members[i]; }
+    constexpr const T& operator[](std::size_t i) const { return this->*members[i]; }
+
+private:
+    static constexpr T VectorStorage::* members[] = { &VectorStorage::x, &VectorStorage::y };
+};
+
+template <typename T>
+struct VectorStorage<T, 3>
+{
+    T x{}, y{}, z{};
+
+    constexpr T& operator[](std::size_t i) { return this->*members[i]; }
+    constexpr const T& operator[](std::size_t i) const { return this->*members[i]; }
+
+private:
+    static constexpr T VectorStorage::* members[] = { &VectorStorage::x, &VectorStorage::y, &VectorStorage::z };
+};
+
+template <typename T>
+struct VectorStorage<T, 4>
+{
+    T x{}, y{}, z{}, w{};
+
+    constexpr T& operator[](std::size_t i) { return this->*members[i]; }
+    constexpr const T& operator[](std::size_t i) const { return this->*members[i]; }
+
+private:
+    static constexpr T VectorStorage::* members[] = { &VectorStorage::x, &VectorStorage::y, &VectorStorage::z, &VectorStorage::w };
 };
 
-class Vector3D
+// Fixed size vector. Every component-wise loop is expanded at compile time through
+// an index_sequence, so there are no runtime loops or dimension checks.
+// T is the precision: float halves the memory traffic of double, long double extends it.
+template <typename T, std::size_t N>
+class VectorN : public VectorStorage<T, N>
 {
+    static_assert(N >= 2, "VectorN needs at least 2 components");
+    static_assert(std::is_floating_point_v<T>, "VectorN components must be float, double or long double");
+
 public:
-    double x, y, z;
-
-    Vector3D();
-    Vector3D(double x, double y, double z);
-
-    Vector3D operator+(const Vector3D& other) const;
-    Vector3D operator-(const Vector3D& other) const;
-    Vector3D operator*(double scalar) const;
-    double dotProduct(const Vector3D& other) const;
-    Vector3D crossProduct(const Vector3D& other) const; // Yields a vector that is orthogonal to the 2 Input Vectors
-    double magnitude() const;
-    double angleBetween(const Vector3D& other) const;
-    Vector3D normalize() const;
-};
\ No newline at end of file
+    using value_type = T;
+    static constexpr std::size_t dimension = N;
+
+    constexpr VectorN() = default;
+
+    template <typename... Components>
+        requires (sizeof...(Components) == N && (std::is_convertible_v<Components, T> && ...))
+    constexpr VectorN(Components... components)
+    {
+        std::size_t i = 0;
+        (((*this)[i++] = static_cast<T>(components)), ...);
+    }
+
+    // Converts from another precision, e.g. Vector3f(someVector3D). Explicit because it may round.
+    template <typename U>
+        requires (!std::is_same_v<U, T>)
+    explicit constexpr VectorN(const VectorN<U, N>& other)
+    {
+        for (std::size_t i = 0; i < N; ++i)
+            (*this)[i] = static_cast<T>(other[i]);
+    }
+
+    constexpr VectorN operator+(const VectorN& other) const
+    {
+        return generate([&](auto i) { return (*this)[i] + other[i]; });
+    }
+
+    constexpr VectorN operator-(const VectorN& other) const
+    {
+        return generate([&](auto i) { return (*this)[i] - other[i]; });
+    }
+
+    constexpr VectorN operator*(T scalar) const
+    {
+        return generate([&](auto i) { return scalar * (*this)[i]; });
+    }
+
+    constexpr VectorN& operator+=(const VectorN& other)
+    {
+        forEach([&](auto i) { (*this)[i] += other[i]; });
+        return *this;
+    }
+
+    constexpr VectorN& operator-=(const VectorN& other)
+    {
+        forEach([&](auto i) { (*this)[i] -= other[i]; });
+        return *this;
+    }
+
+    constexpr VectorN& operator*=(T scalar)
+    {
+        forEach([&](auto i) { (*this)[i] *= scalar; });
+        return *this;
+    }
+
+    constexpr T dotProduct(const VectorN& other) const
+    {
+        return sum([&](auto i) { return (*this)[i] * other[i]; });
+    }
+
+    // Dot product accumulated with std::fma, so every step rounds once. More accurate than
+    // dotProduct, but only fast where the target has FMA instructions (std::fma is emulated otherwise).
+    T dotProductFma(const VectorN& other) const
+    {
+        T result = T(0);
+        forEach([&](auto i) { result = std::fma((*this)[i], other[i], result); });
+        return result;
+    }
+
+    // Yields a vector that is orthogonal to the 2 Input Vectors
+    constexpr VectorN crossProduct(const VectorN& other) const requires (N == 3)
+    {
+        return VectorN(((this->y * other.z) - (this->z * other.y)),
+                       ((this->z * other.x) - (this->x * other.z)),
+                       ((this->x * other.y) - (this->y * other.x)));
+    }
+
+    // Compare squared lengths and distances where possible; they skip the sqrt.
+    constexpr T magnitudeSquared() const
+    {
+        return this->dotProduct(*this);
+    }
+
+    T magnitude() const
+    {
+        return std::sqrt(this->magnitudeSquared());
+    }
+
+    constexpr T distanceSquared(const VectorN& other) const
+    {
+        return sum([&](auto i) { T d = (*this)[i] - other[i]; return d * d; });
+    }
+
+    T distance(const VectorN& other) const
+    {
+        return std::sqrt(this->distanceSquared(other));
+    }
+
+    // True if other lies within radius of this point (inclusive), without a sqrt.
+    constexpr bool isWithinRadius(const VectorN& other, T radius) const
+    {
+        return this->distanceSquared(other) <= radius * radius;
+    }
+
+    // atan2(|a x b|, a . b) needs no magnitudes or division and, unlike acos of the cosine,
+    // stays accurate near 0 and 180 degrees. Above 3 components there is no cross product,
+    // so Kahan's 2 * atan2(|a|b| - b|a||, |a|b| + b|a||) is used instead.
+    T angleBetween(const VectorN& other, AngleUnit unit = AngleUnit::Degrees) const
+    {
+        T resultantAngle;
+        if constexpr (N == 2)
+        {
+            T cross = (this->x * other.y) - (this->y * other.x);
+            resultantAngle = std::atan2(std::abs(cross), this->dotProduct(other));
+        }
+        else if constexpr (N == 3)
+        {
+            resultantAngle = std::atan2(this->crossProduct(other).magnitude(), this->dotProduct(other));
+        }
+        else
+        {
+            VectorN a = (*this) * other.magnitude();
+            VectorN b = other * this->magnitude();
+            resultantAngle = T(2) * std::atan2((a - b).magnitude(), (a + b).magnitude());
+        }
+
+        if (unit == AngleUnit::Radians)
+            return resultantAngle;
+        return resultantAngle * (T(180) / std::numbers::pi_v<T>); // convert from radians to degrees
+    }
+
+    // A zero-length vector normalizes to the zero vector rather than NaN.
+    VectorN normalize() const
+    {
+        T magnitude = this->magnitude();
+        bool nonZero = magnitude > T(0);
+        return generate([&](auto i) { return nonZero ? (*this)[i] / magnitude : T(0); });
+    }
+
+    void normalizeInPlace()
+    {
+        T magnitude = this->magnitude();
+        bool nonZero = magnitude > T(0);
+        forEach([&](auto i) { (*this)[i] = nonZero ? (*this)[i] / magnitude : T(0); });
+    }
+
+    // Component along axis: axis * (this . axis) / (axis . axis). axis need not be normalized;
+    // a zero axis projects everything to the zero vector.
+    constexpr VectorN projectOnto(const VectorN& axis) const
+    {
+        T axisLengthSquared = axis.magnitudeSquared();
+        if (!(axisLengthSquared > T(0)))
+            return VectorN();
+        return axis * (this->dotProduct(axis) / axisLengthSquared);
+    }
+
+    // What remains after removing the component along axis, i.e. the projection onto the
+    // plane (or line, in 2D) with normal axis.
+    constexpr VectorN rejectFrom(const VectorN& axis) const
+    {
+        return *this - this->projectOnto(axis);
+    }
+
+    // Mirror image about the plane (or line) with the given normal, which need not be normalized.
+    constexpr VectorN reflect(const VectorN& normal) const
+    {
+        return *this - (this->projectOnto(normal) * T(2));
+    }
+
+private:
+    // Builds a vector from f(0) ... f(N - 1); f receives the index as a compile time constant.
+    template <typename F>
+    static constexpr VectorN generate(F f)
+    {
+        return [&]<std::size_t... I>(std::index_sequence<I...>) {
+            return VectorN(f(std::integral_constant<std::size_t, I>{})...);
+        }(std::make_index_sequence<N>{});
+    }
+
+    // Calls f(0) ... f(N - 1) in index order.
+    template <typename F>
+    static constexpr void forEach(F f)
+    {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (f(std::integral_constant<std::size_t, I>{}), ...);
+        }(std::make_index_sequence<N>{});
+    }
+
+    // Sums f(0) + ... + f(N - 1) in index order.
+    template <typename F>
+    static constexpr T sum(F f)
+    {
+        return [&]<std::size_t... I>(std::index_sequence<I...>) {
+            return (f(std::integral_constant<std::size_t, I>{}) + ...);
+        }(std::make_index_sequence<N>{});
+    }
+};
+
+// y = a * x + y, in place.
+template <typename T, std::size_t N>
+constexpr void axpy(T a, const VectorN<T, N>& x, VectorN<T, N>& y)
+{
+    for (std::size_t i = 0; i < N; ++i)
+        y[i] = (a * x[i]) + y[i];
+}
+
+template <typename T> using Vector2 = VectorN<T, 2>;
+template <typename T> using Vector3 = VectorN<T, 3>;
+template <typename T> using Vector4 = VectorN<T, 4>;
+
+// double is the calculator's default precision.
+using Vector2D = Vector2<double>;
+using Vector3D = Vector3<double>;
+using Vector4D = Vector4<double>;
+
+using Vector2f = Vector2<float>;
+using Vector3f = Vector3<float>;
+using Vector4f = Vector4<float>;
+
+using Vector2ld = Vector2<long double>;
+using Vector3ld = Vector3<long double>;
+using Vector4ld = Vector4<long double>;
@@ -0,0 +1,534 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <memory_resource>
+#include <numbers>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "batch_expression.hpp"
+#include "vector.hpp"
+#include "vector_simd.hpp"
+
+// Exact divides by the true magnitude. Fast multiplies by a hardware reciprocal square
+// root estimate plus one Newton step (see BatchKernels::normalize3Fast for the error
+// bound); it only differs from Exact for 3 component double batches.
+enum class NormalizeMode
+{
+    Exact,
+    Fast
+};
+
+// Structure-of-arrays container for many vectors of the same size. Each component
+// (all x values, all y values, ...) is stored in its own contiguous array, so batch
+// operations stream through memory and vectorize without gathers.
+// double batches run on the runtime-dispatched SIMD kernels from vector_simd.hpp,
+// other precisions use plain loops.
+// Batches also combine with +, - and * into expression templates (batch_expression.hpp),
+// e.g. result = (a + b) * s - c runs as a single loop without temporary batches.
+// Storage comes from a std::pmr memory resource, the default one unless a constructor is
+// given another, e.g. an Arena (arena.hpp) for intermediate results. Copies use the default
+// resource again; moves and assignments keep their own.
+template <typename T, std::size_t N>
+class VectorBatch : public BatchExpression<VectorBatch<T, N>>
+{
+public:
+    using value_type = T;
+    using vector_type = VectorN<T, N>;
+    static constexpr std::size_t dimension = N;
+
+    VectorBatch() = default;
+    explicit VectorBatch(std::size_t count) { resize(count); }
+
+    explicit VectorBatch(std::pmr::memory_resource* resource)
+        : components(makeComponents(resource, std::make_index_sequence<N>()))
+    {
+    }
+
+    VectorBatch(std::size_t count, std::pmr::memory_resource* resource) : VectorBatch(resource) { resize(count); }
+
+    explicit VectorBatch(const std::vector<vector_type>& vectors)
+    {
+        resize(vectors.size());
+        for (std::size_t i = 0; i < vectors.size(); ++i)
+            set(i, vectors[i]);
+    }
+
+    // Evaluates an expression template in one pass.
+    template <typename E>
+    VectorBatch(const BatchExpression<E>& expression)
+    {
+        assign(expression.self());
+    }
+
+    template <typename E>
+    VectorBatch(const BatchExpression<E>& expression, std::pmr::memory_resource* resource) : VectorBatch(resource)
+    {
+        assign(expression.self());
+    }
+
+    template <typename E>
+    VectorBatch& operator=(const BatchExpression<E>& expression)
+    {
+        assign(expression.self());
+        return *this;
+    }
+
+    std::size_t size() const { return components[0].size(); }
+    bool empty() const { return components[0].empty(); }
+    std::pmr::memory_resource* resource() const { return components[0].get_allocator().resource(); }
+
+    void resize(std::size_t count)
+    {
+        for (auto& component : components)
+            component.resize(count);
+    }
+
+    void reserve(std::size_t count)
+    {
+        for (auto& component : components)
+            component.reserve(count);
+    }
+
+    void clear()
+    {
+        for (auto& component : components)
+            component.clear();
+    }
+
+    void push_back(const vector_type& v)
+    {
+        for (std::size_t axis = 0; axis < N; ++axis)
+            components[axis].push_back(v[axis]);
+    }
+
+    // Gathers element i into a VectorN. Prefer the batch operations in hot loops.
+    vector_type operator[](std::size_t i) const
+    {
+        vector_type v;
+        for (std::size_t axis = 0; axis < N; ++axis)
+            v[axis] = components[axis][i];
+        return v;
+    }
+
+    void set(std::size_t i, const vector_type& v)
+    {
+        for (std::size_t axis = 0; axis < N; ++axis)
+            components[axis][i] = v[axis];
+    }
+
+    // In-place arithmetic; the right hand side may be a batch or an expression template.
+    template <typename E>
+    VectorBatch& operator+=(const BatchExpression<E>& expression)
+    {
+        const E& e = expression.self();
+        assert(e.size() == size());
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            T* r = component(axis);
+            for (std::size_t i = 0; i < size(); ++i)
+                r[i] += e.value(axis, i);
+        }
+        return *this;
+    }
+
+    template <typename E>
+    VectorBatch& operator-=(const BatchExpression<E>& expression)
+    {
+        const E& e = expression.self();
+        assert(e.size() == size());
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            T* r = component(axis);
+            for (std::size_t i = 0; i < size(); ++i)
+                r[i] -= e.value(axis, i);
+        }
+        return *this;
+    }
+
+    VectorBatch& operator*=(T scalar)
+    {
+        scale(scalar, *this);
+        return *this;
+    }
+
+    // Expression template leaf access.
+    T value(std::size_t axis, std::size_t i) const { return components[axis][i]; }
+
+    // Contiguous array of one component, size() elements long.
+    T* component(std::size_t axis) { return components[axis].data(); }
+    const T* component(std::size_t axis) const { return components[axis].data(); }
+
+    T* x() { return component(0); }
+    T* y() { return component(1); }
+    T* z() requires (N >= 3) { return component(2); }
+    const T* x() const { return component(0); }
+    const T* y() const { return component(1); }
+    const T* z() const requires (N >= 3) { return component(2); }
+
+    // Batch versions of the VectorN operations. Both operands must have the same size.
+    // Batch results are resized to fit; scalar results are written to a caller buffer of
+    // size() elements. out may be the same batch as *this or other.
+
+    static constexpr bool hasSimdKernels = std::is_same_v<T, double>;
+
+    void add(const VectorBatch& other, VectorBatch& out) const
+    {
+        assert(other.size() == size());
+        out.resize(size());
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            const T* a = component(axis);
+            const T* b = other.component(axis);
+            T* r = out.component(axis);
+            if constexpr (hasSimdKernels)
+            {
+                batchKernels().add(a, b, r, size());
+                continue;
+            }
+            for (std::size_t i = 0; i < size(); ++i)
+                r[i] = a[i] + b[i];
+        }
+    }
+
+    void subtract(const VectorBatch& other, VectorBatch& out) const
+    {
+        assert(other.size() == size());
+        out.resize(size());
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            const T* a = component(axis);
+            const T* b = other.component(axis);
+            T* r = out.component(axis);
+            if constexpr (hasSimdKernels)
+            {
+                batchKernels().subtract(a, b, r, size());
+                continue;
+            }
+            for (std::size_t i = 0; i < size(); ++i)
+                r[i] = a[i] - b[i];
+        }
+    }
+
+    // Batch operator*
+    void scale(T scalar, VectorBatch& out) const
+    {
+        out.resize(size());
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            const T* a = component(axis);
+            T* r = out.component(axis);
+            if constexpr (hasSimdKernels)
+            {
+                batchKernels().scale(a, scalar, r, size());
+                continue;
+            }
+            for (std::size_t i = 0; i < size(); ++i)
+                r[i] = scalar * a[i];
+        }
+    }
+
+    void dotProduct(const VectorBatch& other, T* out) const
+    {
+        assert(other.size() == size());
+        if constexpr (hasSimdKernels && N == 3)
+        {
+            batchKernels().dotProduct3(x(), y(), z(), other.x(), other.y(), other.z(), out, size());
+            return;
+        }
+        std::fill(out, out + size(), T(0));
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            const T* a = component(axis);
+            const T* b = other.component(axis);
+            for (std::size_t i = 0; i < size(); ++i)
+                out[i] += a[i] * b[i];
+        }
+    }
+
+    void crossProduct(const VectorBatch& other, VectorBatch& out) const requires (N == 3)
+    {
+        assert(other.size() == size());
+        out.resize(size());
+        if constexpr (hasSimdKernels)
+        {
+            batchKernels().crossProduct3(x(), y(), z(), other.x(), other.y(), other.z(), out.x(), out.y(), out.z(), size());
+            return;
+        }
+        const T *ax = x(), *ay = y(), *az = z();
+        const T *bx = other.x(), *by = other.y(), *bz = other.z();
+        T *rx = out.x(), *ry = out.y(), *rz = out.z();
+        for (std::size_t i = 0; i < size(); ++i)
+        {
+            T cx = (ay[i] * bz[i]) - (az[i] * by[i]);
+            T cy = (az[i] * bx[i]) - (ax[i] * bz[i]);
+            T cz = (ax[i] * by[i]) - (ay[i] * bx[i]);
+            rx[i] = cx;
+            ry[i] = cy;
+            rz[i] = cz;
+        }
+    }
+
+    void magnitude(T* out) const
+    {
+        if constexpr (hasSimdKernels && N == 3)
+        {
+            batchKernels().magnitude3(x(), y(), z(), out, size());
+            return;
+        }
+        dotProduct(*this, out);
+        for (std::size_t i = 0; i < size(); ++i)
+            out[i] = std::sqrt(out[i]);
+    }
+
+    // Dot products accumulated with std::fma, like VectorN::dotProductFma.
+    void dotProductFma(const VectorBatch& other, T* out) const
+    {
+        assert(other.size() == size());
+        std::fill(out, out + size(), T(0));
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            const T* a = component(axis);
+            const T* b = other.component(axis);
+            for (std::size_t i = 0; i < size(); ++i)
+                out[i] = std::fma(a[i], b[i], out[i]);
+        }
+    }
+
+    // Zero-length vectors normalize to zero, like VectorN::normalize.
+    void normalize(VectorBatch& out, NormalizeMode mode = NormalizeMode::Exact) const
+    {
+        out.resize(size());
+        if constexpr (hasSimdKernels && N == 3)
+        {
+            const BatchKernels& kernels = batchKernels();
+            auto kernel = mode == NormalizeMode::Fast ? kernels.normalize3Fast : kernels.normalize3;
+            kernel(x(), y(), z(), out.x(), out.y(), out.z(), size());
+            return;
+        }
+        for (std::size_t i = 0; i < size(); ++i)
+        {
+            T lengthSquared = T(0);
+            for (std::size_t axis = 0; axis < N; ++axis)
+                lengthSquared += components[axis][i] * components[axis][i];
+            T magnitude = std::sqrt(lengthSquared);
+            bool nonZero = lengthSquared > T(0);
+            for (std::size_t axis = 0; axis < N; ++axis)
+                out.components[axis][i] = nonZero ? components[axis][i] / magnitude : T(0);
+        }
+    }
+
+    void magnitudeSquared(T* out) const
+    {
+        dotProduct(*this, out);
+    }
+
+    void distanceSquared(const VectorBatch& other, T* out) const
+    {
+        assert(other.size() == size());
+        std::fill(out, out + size(), T(0));
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            const T* a = component(axis);
+            const T* b = other.component(axis);
+            for (std::size_t i = 0; i < size(); ++i)
+            {
+                T d = a[i] - b[i];
+                out[i] += d * d;
+            }
+        }
+    }
+
+    // Squared distance from every element to one point.
+    void distanceSquared(const vector_type& point, T* out) const
+    {
+        std::fill(out, out + size(), T(0));
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            const T* a = component(axis);
+            const T p = point[axis];
+            for (std::size_t i = 0; i < size(); ++i)
+            {
+                T d = a[i] - p;
+                out[i] += d * d;
+            }
+        }
+    }
+
+    void distance(const VectorBatch& other, T* out) const
+    {
+        distanceSquared(other, out);
+        for (std::size_t i = 0; i < size(); ++i)
+            out[i] = std::sqrt(out[i]);
+    }
+
+    void distance(const vector_type& point, T* out) const
+    {
+        distanceSquared(point, out);
+        for (std::size_t i = 0; i < size(); ++i)
+            out[i] = std::sqrt(out[i]);
+    }
+
+    // out[i] = element i lies within radius of center (inclusive), compared squared.
+    void isWithinRadius(const vector_type& center, T radius, bool* out) const
+    {
+        const T radiusSquared = radius * radius;
+        for (std::size_t i = 0; i < size(); ++i)
+        {
+            T lengthSquared = T(0);
+            for (std::size_t axis = 0; axis < N; ++axis)
+            {
+                T d = components[axis][i] - center[axis];
+                lengthSquared += d * d;
+            }
+            out[i] = lengthSquared <= radiusSquared;
+        }
+    }
+
+    void normalizeInPlace(NormalizeMode mode = NormalizeMode::Exact)
+    {
+        normalize(*this, mode);
+    }
+
+    // Batch forms of VectorN::projectOnto, rejectFrom and reflect for one shared axis, fused
+    // into a single pass: 1 / (axis . axis) is computed once, then every element costs one
+    // dot product and one multiply-add per component.
+    void projectOnto(const vector_type& axis, VectorBatch& out) const { combineWithAxis(axis, T(0), T(1), out); }
+    void rejectFrom(const vector_type& axis, VectorBatch& out) const { combineWithAxis(axis, T(1), T(-1), out); }
+    void reflect(const vector_type& normal, VectorBatch& out) const { combineWithAxis(normal, T(1), T(-2), out); }
+
+    // The same with a different axis for every element: element i against axes[i].
+    void projectOnto(const VectorBatch& axes, VectorBatch& out) const { combineWithAxes(axes, T(0), T(1), out); }
+    void rejectFrom(const VectorBatch& axes, VectorBatch& out) const { combineWithAxes(axes, T(1), T(-1), out); }
+    void reflect(const VectorBatch& normals, VectorBatch& out) const { combineWithAxes(normals, T(1), T(-2), out); }
+
+    // Same atan2 formulation as VectorN::angleBetween. For 2 and 3 components the cross
+    // and dot products are computed inline, so each element costs one sqrt and one atan2.
+    void angleBetween(const VectorBatch& other, T* out, AngleUnit unit = AngleUnit::Degrees) const
+    {
+        assert(other.size() == size());
+        const T toUnit = unit == AngleUnit::Radians ? T(1) : T(180) / std::numbers::pi_v<T>;
+        if constexpr (N == 2)
+        {
+            const T *ax = x(), *ay = y(), *bx = other.x(), *by = other.y();
+            for (std::size_t i = 0; i < size(); ++i)
+            {
+                T cross = (ax[i] * by[i]) - (ay[i] * bx[i]);
+                T dot = (ax[i] * bx[i]) + (ay[i] * by[i]);
+                out[i] = std::atan2(std::abs(cross), dot) * toUnit;
+            }
+        }
+        else if constexpr (N == 3)
+        {
+            const T *ax = x(), *ay = y(), *az = z();
+            const T *bx = other.x(), *by = other.y(), *bz = other.z();
+            for (std::size_t i = 0; i < size(); ++i)
+            {
+                T cx = (ay[i] * bz[i]) - (az[i] * by[i]);
+                T cy = (az[i] * bx[i]) - (ax[i] * bz[i]);
+                T cz = (ax[i] * by[i]) - (ay[i] * bx[i]);
+                T dot = (ax[i] * bx[i]) + (ay[i] * by[i]) + (az[i] * bz[i]);
+                out[i] = std::atan2(std::sqrt((cx * cx) + (cy * cy) + (cz * cz)), dot) * toUnit;
+            }
+        }
+        else
+        {
+            for (std::size_t i = 0; i < size(); ++i)
+                out[i] = (*this)[i].angleBetween(other[i], unit);
+        }
+    }
+
+private:
+    std::array<std::pmr::vector<T>, N> components;
+
+    template <std::size_t... Axis>
+    static std::array<std::pmr::vector<T>, N> makeComponents(std::pmr::memory_resource* resource, std::index_sequence<Axis...>)
+    {
+        return { ((void)Axis, std::pmr::vector<T>(resource))... };
+    }
+
+    // out[i] = c * v + k * (v . axis) / (axis . axis) * axis, for v = element i.
+    void combineWithAxis(const vector_type& axis, T c, T k, VectorBatch& out) const
+    {
+        out.resize(size());
+        T axisLengthSquared = axis.magnitudeSquared();
+        T scale = axisLengthSquared > T(0) ? k / axisLengthSquared : T(0);
+        if constexpr (hasSimdKernels && N == 3)
+        {
+            const double a[3] = { axis.x, axis.y, axis.z };
+            batchKernels().projectAxis3(a, c, scale, x(), y(), z(), out.x(), out.y(), out.z(), size());
+            return;
+        }
+        for (std::size_t i = 0; i < size(); ++i)
+        {
+            T dot = T(0);
+            for (std::size_t d = 0; d < N; ++d)
+                dot += components[d][i] * axis[d];
+            T f = scale * dot;
+            for (std::size_t d = 0; d < N; ++d)
+                out.components[d][i] = (c * components[d][i]) + (f * axis[d]);
+        }
+    }
+
+    void combineWithAxes(const VectorBatch& axes, T c, T k, VectorBatch& out) const
+    {
+        assert(axes.size() == size());
+        out.resize(size());
+        for (std::size_t i = 0; i < size(); ++i)
+        {
+            T dot = T(0);
+            T axisLengthSquared = T(0);
+            for (std::size_t d = 0; d < N; ++d)
+            {
+                dot += components[d][i] * axes.components[d][i];
+                axisLengthSquared += axes.components[d][i] * axes.components[d][i];
+            }
+            T f = axisLengthSquared > T(0) ? (k * dot) / axisLengthSquared : T(0);
+            for (std::size_t d = 0; d < N; ++d)
+                out.components[d][i] = (c * components[d][i]) + (f * axes.components[d][i]);
+        }
+    }
+
+    template <typename E>
+    void assign(const E& expression)
+    {
+        static_assert(std::is_same_v<typename E::value_type, T> && E::dimension == N, "expression does not match the batch type");
+        std::size_t count = expression.size();
+        resize(count);
+        for (std::size_t axis = 0; axis < N; ++axis)
+        {
+            T* r = component(axis);
+            for (std::size_t i = 0; i < count; ++i)
+                r[i] = expression.value(axis, i);
+        }
+    }
+};
+
+// y = a * x + y over whole batches, in one pass and without temporaries.
+template <typename T, std::size_t N>
+void axpy(T a, const VectorBatch<T, N>& x, VectorBatch<T, N>& y)
+{
+    assert(x.size() == y.size());
+    for (std::size_t axis = 0; axis < N; ++axis)
+    {
+        const T* xs = x.component(axis);
+        T* ys = y.component(axis);
+        if constexpr (VectorBatch<T, N>::hasSimdKernels)
+        {
+            batchKernels().axpy(a, xs, ys, y.size());
+            continue;
+        }
+        for (std::size_t i = 0; i < y.size(); ++i)
+            ys[i] = (a * xs[i]) + ys[i];
+    }
+}
+
+using Vector2DBatch = VectorBatch<double, 2>;
+using Vector3DBatch = VectorBatch<double, 3>;
+
+using Vector2fBatch = VectorBatch<float, 2>;
+using Vector3fBatch = VectorBatch<float, 3>;
@@ -0,0 +1,177 @@
+#include "vector_simd.hpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SIMD_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#ifdef SIMD_X86
+    struct CpuidRegisters
+    {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    };
+
+    CpuidRegisters cpuid(unsigned int leaf, unsigned int subleaf)
+    {
+        CpuidRegisters r;
+#if defined(_MSC_VER)
+        int regs[4];
+        __cpuidex(regs, static_cast<int>(leaf), static_cast<int>(subleaf));
+        r.eax = regs[0];
+        r.ebx = regs[1];
+        r.ecx = regs[2];
+        r.edx = regs[3];
+#else
+        __cpuid_count(leaf, subleaf, r.eax, r.ebx, r.ecx, r.edx);
+#endif
+        return r;
+    }
+
+    // XCR0: which register states the OS saves on context switch.
+    unsigned long long xgetbv0()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        unsigned int lo, hi;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        return (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+    }
+
+    SimdLevel detectCpu()
+    {
+        unsigned int maxLeaf = cpuid(0, 0).eax;
+        CpuidRegisters leaf1 = cpuid(1, 0);
+
+        bool sse2 = (leaf1.edx & (1u << 26)) != 0;
+        if (!sse2)
+            return SimdLevel::Scalar;
+
+        bool osxsave = (leaf1.ecx & (1u << 27)) != 0;
+        bool avx = (leaf1.ecx & (1u << 28)) != 0;
+        bool fma = (leaf1.ecx & (1u << 12)) != 0;
+        bool f16c = (leaf1.ecx & (1u << 29)) != 0;
+        if (!osxsave || !avx || !fma || !f16c || maxLeaf < 7)
+            return SimdLevel::SSE2;
+
+        unsigned long long xcr0 = xgetbv0();
+        bool ymmState = (xcr0 & 0x6) == 0x6;   // XMM and YMM
+        bool zmmState = (xcr0 & 0xE6) == 0xE6; // plus opmask and both ZMM halves
+        if (!ymmState)
+            return SimdLevel::SSE2;
+
+        CpuidRegisters leaf7 = cpuid(7, 0);
+        bool avx2 = (leaf7.ebx & (1u << 5)) != 0;
+        bool avx512f = (leaf7.ebx & (1u << 16)) != 0;
+        if (!avx2)
+            return SimdLevel::SSE2;
+        if (!avx512f || !zmmState)
+            return SimdLevel::AVX2;
+        return SimdLevel::AVX512;
+    }
+
+    // Only asked about levels the CPU supports, so leaf 7 exists.
+    bool cpuHasAvxVnni()
+    {
+        return cpuid(7, 0).eax >= 1 && (cpuid(7, 1).eax & (1u << 4)) != 0;
+    }
+
+    bool cpuHasAvx512Vnni()
+    {
+        return (cpuid(7, 0).ecx & (1u << 11)) != 0;
+    }
+#else
+    SimdLevel detectCpu()
+    {
+        return SimdLevel::Scalar;
+    }
+
+    bool cpuHasAvxVnni()
+    {
+        return false;
+    }
+
+    bool cpuHasAvx512Vnni()
+    {
+        return false;
+    }
+#endif
+
+    // table, or a copy of it using vnni for dotProductU8I8 when there is one.
+    const BatchKernels* withVnni(const BatchKernels* table, DotProductU8I8 vnni, BatchKernels& copy)
+    {
+        if (table == nullptr || vnni == nullptr)
+            return table;
+        copy = *table;
+        copy.dotProductU8I8 = vnni;
+        return &copy;
+    }
+
+    const BatchKernels* compiledKernels(SimdLevel level)
+    {
+        switch (level)
+        {
+        case SimdLevel::Scalar: return scalarBatchKernels();
+        case SimdLevel::SSE2: return sse2BatchKernels();
+        case SimdLevel::AVX2:
+        {
+            static BatchKernels copy;
+            static const BatchKernels* table = withVnni(avx2BatchKernels(), cpuHasAvxVnni() ? avxVnniDotProductU8I8() : nullptr, copy);
+            return table;
+        }
+        case SimdLevel::AVX512:
+        {
+            static BatchKernels copy;
+            static const BatchKernels* table = withVnni(avx512BatchKernels(), cpuHasAvx512Vnni() ? avx512VnniDotProductU8I8() : nullptr, copy);
+            return table;
+        }
+        }
+        return nullptr;
+    }
+}
+
+SimdLevel detectSimdLevel()
+{
+    static const SimdLevel level = detectCpu();
+    return level;
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar: return "Scalar";
+    case SimdLevel::SSE2: return "SSE2";
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::AVX512: return "AVX-512";
+    }
+    return "Unknown";
+}
+
+const BatchKernels& batchKernels()
+{
+    // Best level that is both supported and compiled in; the scalar table always exists.
+    static const BatchKernels& kernels = []() -> const BatchKernels& {
+        for (int level = static_cast<int>(detectSimdLevel()); level > 0; --level)
+        {
+            if (const BatchKernels* table = compiledKernels(static_cast<SimdLevel>(level)))
+                return *table;
+        }
+        return *scalarBatchKernels();
+    }();
+    return kernels;
+}
+
+const BatchKernels* batchKernels(SimdLevel level)
+{
+    if (level > detectSimdLevel())
+        return nullptr;
+    return compiledKernels(level);
+}
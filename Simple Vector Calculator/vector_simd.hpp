@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Instruction set levels for the batch kernels, in increasing order.
+enum class SimdLevel
+{
+    Scalar = 0,
+    SSE2,
+    AVX2,   // AVX2 + FMA + F16C
+    AVX512  // AVX-512F
+};
+
+// One set of batch kernels for a single instruction set. All kernels work on
+// structure-of-arrays data (see VectorBatch): every pointer is a component array of
+// n doubles, or n floats for the F32 kernels. Outputs may alias inputs element for element.
+struct BatchKernels
+{
+    SimdLevel level;
+
+    void (*add)(const double* a, const double* b, double* out, std::size_t n);
+    void (*subtract)(const double* a, const double* b, double* out, std::size_t n);
+    void (*scale)(const double* a, double scalar, double* out, std::size_t n);
+    void (*axpy)(double a, const double* x, double* y, std::size_t n); // y = a * x + y
+
+    // Reductions of one array. minMax widens [*low, *high] to cover a[0, n), so chunks
+    // can be folded into a running range; start from a[0] or +-infinity.
+    double (*sum)(const double* a, std::size_t n);
+    // Error-compensated sum: the error does not grow with n, and the result is the same
+    // bits on every level. See the kernel for the exact bound.
+    double (*sumCompensated)(const double* a, std::size_t n);
+    void (*minMax)(const double* a, std::size_t n, double* low, double* high);
+    // First and second moments of 3D points about origin, d = p - origin: out[0..2] = sums of
+    // dx, dy, dz and out[3..8] = sums of dx dx, dx dy, dx dz, dy dy, dy dz, dz dz.
+    void (*moments3)(const double* origin, const double* x, const double* y, const double* z,
+                     std::size_t n, double* out);
+
+    void (*dotProduct3)(const double* ax, const double* ay, const double* az,
+                        const double* bx, const double* by, const double* bz,
+                        double* out, std::size_t n);
+    void (*crossProduct3)(const double* ax, const double* ay, const double* az,
+                          const double* bx, const double* by, const double* bz,
+                          double* rx, double* ry, double* rz, std::size_t n);
+    void (*magnitude3)(const double* x, const double* y, const double* z, double* out, std::size_t n);
+
+    // Squared distance from the point (px, py, pz) to each of the n points.
+    void (*distanceSquared3)(double px, double py, double pz,
+                             const double* x, const double* y, const double* z,
+                             double* out, std::size_t n);
+
+    // Zero-length vectors normalize to zero instead of NaN, without a branch. Both forms hold
+    // for lengths whose square is a normal double, about 1e-154 to 1e154.
+    // normalize3 divides by the exact magnitude: every component within 3 ULPs. normalize3Fast
+    // multiplies by a hardware reciprocal square root estimate refined with one Newton step.
+    // The estimate scales the squared length into range by a power of two first, so the
+    // error is the same at every length: a relative error below 2^-22, 2^31 ULPs per
+    // component, for SSE2/AVX2 (float rsqrtps) and below 2^-27, 2^26 ULPs, for AVX-512
+    // (rsqrt14). The scalar table is exact, within 3 ULPs.
+    void (*normalize3)(const double* x, const double* y, const double* z,
+                       double* rx, double* ry, double* rz, std::size_t n);
+    void (*normalize3Fast)(const double* x, const double* y, const double* z,
+                           double* rx, double* ry, double* rz, std::size_t n);
+
+    // r = c v + k (v . axis) axis for every v: projection onto axis (c = 0, k = 1 / axis . axis),
+    // rejection (c = 1, k = -1 / axis . axis) or reflection (c = 1, k = -2 / axis . axis).
+    void (*projectAxis3)(const double* axis, double c, double k, const double* x, const double* y, const double* z,
+                         double* rx, double* ry, double* rz, std::size_t n);
+
+    // Transforms of 3D points. transform3 applies one affine transform, given as a row-major
+    // 3x4 matrix m = [M | t], to every point: r = M p + t. quaternionToMatrix3 turns unit
+    // quaternions (x, y, z, w) into rotation matrices stored as nine row-major arrays
+    // (m[0] = m00, m[1] = m01, ... m[8] = m22), and transform3Each applies those per
+    // element: r[i] = M[i] p[i].
+    void (*transform3)(const double* m, const double* x, const double* y, const double* z,
+                       double* rx, double* ry, double* rz, std::size_t n);
+    void (*quaternionToMatrix3)(const double* qx, const double* qy, const double* qz, const double* qw,
+                                double* const* m, std::size_t n);
+    void (*transform3Each)(const double* const* m, const double* x, const double* y, const double* z,
+                           double* rx, double* ry, double* rz, std::size_t n);
+
+    // Right-handed orthonormal frames, written like quaternionToMatrix3 with the columns
+    // tangent, bitangent and normal. The normals are normalized. orthonormalBasis3 picks the
+    // tangent from the normal alone; orthonormalFrame3 makes the given tangents perpendicular
+    // to the normals and falls back to the basis where a tangent is zero or parallel.
+    void (*orthonormalBasis3)(const double* nx, const double* ny, const double* nz, double* const* m, std::size_t n);
+    void (*orthonormalFrame3)(const double* nx, const double* ny, const double* nz,
+                              const double* tx, const double* ty, const double* tz, double* const* m, std::size_t n);
+
+    // Conversions between float and 16-bit storage (see half.hpp), rounding to nearest even:
+    // IEEE half precision with F16C where available, and bfloat16.
+    void (*widenF16)(const std::uint16_t* in, float* out, std::size_t n);
+    void (*narrowF16)(const float* in, std::uint16_t* out, std::size_t n);
+    void (*widenBF16)(const std::uint16_t* in, float* out, std::size_t n);
+    void (*narrowBF16)(const float* in, std::uint16_t* out, std::size_t n);
+    // dotProduct3 and magnitude3 on 16-bit components, widened in registers and computed in
+    // float: out is n floats.
+    void (*dotProduct3F16)(const std::uint16_t* ax, const std::uint16_t* ay, const std::uint16_t* az,
+                           const std::uint16_t* bx, const std::uint16_t* by, const std::uint16_t* bz, float* out, std::size_t n);
+    void (*dotProduct3BF16)(const std::uint16_t* ax, const std::uint16_t* ay, const std::uint16_t* az,
+                            const std::uint16_t* bx, const std::uint16_t* by, const std::uint16_t* bz, float* out, std::size_t n);
+    void (*magnitude3F16)(const std::uint16_t* x, const std::uint16_t* y, const std::uint16_t* z, float* out, std::size_t n);
+    void (*magnitude3BF16)(const std::uint16_t* x, const std::uint16_t* y, const std::uint16_t* z, float* out, std::size_t n);
+    // dotProduct3 on float components, the same computation as the 16-bit forms above.
+    void (*dotProduct3F32)(const float* ax, const float* ay, const float* az,
+                           const float* bx, const float* by, const float* bz, float* out, std::size_t n);
+
+    // Dot product of unsigned by signed bytes, the operand types of the VNNI instruction
+    // vpdpbusd, which is used where the CPU has it. Exact for n up to 65536.
+    std::int32_t (*dotProductU8I8)(const std::uint8_t* a, const std::int8_t* b, std::size_t n);
+
+    // Dot product of two dense float arrays, e.g. high dimensional embeddings.
+    float (*dotProductF32)(const float* a, const float* b, std::size_t n);
+    // Dot products of queryCount row vectors (queries, dims floats each) with n vectors stored
+    // by column (columns[axis][i]): out[q * n + i] = sum of queries[q * dims + axis] * columns[axis][i].
+    void (*columnDotProductsF32)(const float* const* columns, const float* queries, std::size_t queryCount,
+                                 std::size_t dims, float* out, std::size_t n);
+};
+
+// Best level supported by both the CPU (CPUID) and the OS (saved register state).
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// Kernels for the best available level. Selected once on first use.
+const BatchKernels& batchKernels();
+
+// Kernels for a specific level, or nullptr if the CPU does not support it or it was not
+// compiled in. Useful for comparing levels against each other.
+const BatchKernels* batchKernels(SimdLevel level);
+
+// Per instruction set tables, each defined in its own vector_simd_<isa>.cpp that is
+// compiled for that instruction set: GCC enables it inside the file with #pragma GCC
+// target, the Visual Studio project sets /arch per file, and Clang needs the flags named
+// at the top of each file (e.g. -mavx2 -mfma -mf16c). They return nullptr when the file
+// was compiled without the required instruction set.
+const BatchKernels* scalarBatchKernels();
+const BatchKernels* sse2BatchKernels();
+const BatchKernels* avx2BatchKernels();
+const BatchKernels* avx512BatchKernels();
+
+// VNNI versions of dotProductU8I8 from vector_simd_vnni.cpp, nullptr when not compiled in.
+// The AVX2 and AVX-512 tables swap them in when the CPU has AVX-VNNI (CPUID leaf 7 subleaf 1
+// EAX bit 4) or AVX512_VNNI (leaf 7 ECX bit 11) respectively.
+using DotProductU8I8 = std::int32_t (*)(const std::uint8_t* a, const std::int8_t* b, std::size_t n);
+DotProductU8I8 avxVnniDotProductU8I8();
+DotProductU8I8 avx512VnniDotProductU8I8();
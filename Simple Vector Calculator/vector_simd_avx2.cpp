@@ -0,0 +1,142 @@
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#include "half.hpp"
+#include "vector_simd.hpp"
+
+// GCC can enable the instruction set for this file alone; Clang needs -mavx2 -mfma -mf16c
+// and Visual Studio gets /arch:AVX2 from the project file.
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#pragma GCC target("avx2,fma,f16c")
+#define SIMD_HAVE_AVX2 1
+#elif defined(__AVX2__) && ((defined(__FMA__) && defined(__F16C__)) || defined(_MSC_VER))
+#include <immintrin.h>
+#define SIMD_HAVE_AVX2 1
+#endif
+
+#ifdef SIMD_HAVE_AVX2
+
+namespace
+{
+    struct Avx2Float
+    {
+        using Reg = __m256;
+        static constexpr std::size_t width = 8;
+
+        static Reg load(const float* p) { return _mm256_loadu_ps(p); }
+        static void store(float* p, Reg v) { _mm256_storeu_ps(p, v); }
+        static Reg set1(float v) { return _mm256_set1_ps(v); }
+        static Reg zero() { return _mm256_setzero_ps(); }
+        static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+        static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+        static Reg sqrt(Reg a) { return _mm256_sqrt_ps(a); }
+        static Reg fmadd(Reg a, Reg b, Reg c) { return _mm256_fmadd_ps(a, b, c); }
+        static float reduceAdd(Reg a)
+        {
+            __m128 quad = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+            __m128 pairs = _mm_add_ps(quad, _mm_movehl_ps(quad, quad));
+            return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+        }
+        static Reg loadF16(const std::uint16_t* p) { return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+        static void storeF16(std::uint16_t* p, Reg v)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+        }
+        static Reg loadBF16(const std::uint16_t* p)
+        {
+            __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+            return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+        }
+        static void storeBF16(std::uint16_t* p, Reg v)
+        {
+            __m256i bits = _mm256_castps_si256(v);
+            __m256i odd = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+            __m256i rounded = _mm256_add_epi32(bits, _mm256_add_epi32(_mm256_set1_epi32(0x7FFF), odd));
+            __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+            rounded = _mm256_blendv_epi8(rounded, _mm256_or_si256(bits, _mm256_set1_epi32(0x400000)), nan);
+            // The pack works within 128-bit halves; gather its two useful quarters.
+            __m256i packed = _mm256_packus_epi32(_mm256_srli_epi32(rounded, 16), _mm256_setzero_si256());
+            packed = _mm256_permute4x64_epi64(packed, 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+        }
+    };
+
+    struct Avx2Int8
+    {
+        using Reg = __m256i;
+        static constexpr std::size_t width = 32;
+
+        static Reg zero() { return _mm256_setzero_si256(); }
+        // Widens both operands to 16 bits and lets vpmaddwd multiply and add pairs into
+        // 32-bit lanes. (vpmaddubsw would skip the widening but saturates at 16 bits.)
+        static Reg dotAdd(Reg sum, const std::uint8_t* a, const std::int8_t* b)
+        {
+            for (std::size_t half = 0; half < 32; half += 16)
+            {
+                __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + half)));
+                __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + half)));
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(va, vb));
+            }
+            return sum;
+        }
+        static std::int32_t reduceAdd(Reg sum)
+        {
+            __m128i quad = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            quad = _mm_add_epi32(quad, _mm_shuffle_epi32(quad, 0x4E));
+            quad = _mm_add_epi32(quad, _mm_shuffle_epi32(quad, 0xB1));
+            return _mm_cvtsi128_si32(quad);
+        }
+    };
+
+    struct Avx2
+    {
+        using Float = Avx2Float;
+        using Int8 = Avx2Int8;
+        using Reg = __m256d;
+        static constexpr std::size_t width = 4;
+
+        static Reg load(const double* p) { return _mm256_loadu_pd(p); }
+        static void store(double* p, Reg v) { _mm256_storeu_pd(p, v); }
+        static Reg set1(double v) { return _mm256_set1_pd(v); }
+        static Reg add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+        static Reg sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+        static Reg mul(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+        static Reg div(Reg a, Reg b) { return _mm256_div_pd(a, b); }
+        static Reg sqrt(Reg a) { return _mm256_sqrt_pd(a); }
+        static Reg min(Reg a, Reg b) { return _mm256_min_pd(a, b); }
+        static Reg max(Reg a, Reg b) { return _mm256_max_pd(a, b); }
+        static Reg fmadd(Reg a, Reg b, Reg c) { return _mm256_fmadd_pd(a, b, c); }
+        // Float estimate, range reduced as in the SSE2 form.
+        static Reg rsqrt(Reg a)
+        {
+            __m256i exponent = _mm256_srli_epi64(_mm256_castpd_si256(a), 52);
+            exponent = _mm256_max_epi32(exponent, _mm256_set1_epi64x(1));
+            exponent = _mm256_min_epi32(exponent, _mm256_set1_epi64x(2046));
+            __m256i k = _mm256_srli_epi64(_mm256_add_epi64(exponent, _mm256_set1_epi64x(1)), 1);
+            __m256d down = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_sub_epi64(_mm256_set1_epi64x(2047), _mm256_add_epi64(k, k)), 52));
+            __m256d up = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_sub_epi64(_mm256_set1_epi64x(1535), k), 52));
+            return _mm256_mul_pd(_mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(_mm256_mul_pd(a, down)))), up);
+        }
+        static Reg zeroUnlessPositive(Reg condition, Reg v) { return _mm256_and_pd(_mm256_cmp_pd(condition, _mm256_setzero_pd(), _CMP_GT_OQ), v); }
+        static Reg selectPositive(Reg condition, Reg a, Reg b) { return _mm256_blendv_pd(b, a, _mm256_cmp_pd(condition, _mm256_setzero_pd(), _CMP_GT_OQ)); }
+        static Reg signOf(Reg a) { return _mm256_or_pd(_mm256_and_pd(a, _mm256_set1_pd(-0.0)), _mm256_set1_pd(1.0)); }
+    };
+
+#include "vector_simd_kernels.inl"
+}
+
+const BatchKernels* avx2BatchKernels()
+{
+    return SimdKernels<Avx2>::table(SimdLevel::AVX2);
+}
+
+#else
+
+const BatchKernels* avx2BatchKernels()
+{
+    return nullptr;
+}
+
+#endif
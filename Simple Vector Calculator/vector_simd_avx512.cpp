@@ -0,0 +1,134 @@
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#include "half.hpp"
+#include "vector_simd.hpp"
+
+// GCC can enable the instruction set for this file alone; Clang needs -mavx512f
+// and Visual Studio gets /arch:AVX512 from the project file.
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#pragma GCC target("avx512f")
+// GCC 12 warns about the deliberately undefined registers inside its own intrinsics.
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#define SIMD_HAVE_AVX512 1
+#elif defined(__AVX512F__)
+#include <immintrin.h>
+#define SIMD_HAVE_AVX512 1
+#endif
+
+#ifdef SIMD_HAVE_AVX512
+
+namespace
+{
+    struct Avx512Float
+    {
+        using Reg = __m512;
+        static constexpr std::size_t width = 16;
+
+        static Reg load(const float* p) { return _mm512_loadu_ps(p); }
+        static void store(float* p, Reg v) { _mm512_storeu_ps(p, v); }
+        static Reg set1(float v) { return _mm512_set1_ps(v); }
+        static Reg zero() { return _mm512_setzero_ps(); }
+        static Reg add(Reg a, Reg b) { return _mm512_add_ps(a, b); }
+        static Reg mul(Reg a, Reg b) { return _mm512_mul_ps(a, b); }
+        static Reg sqrt(Reg a) { return _mm512_sqrt_ps(a); }
+        static Reg fmadd(Reg a, Reg b, Reg c) { return _mm512_fmadd_ps(a, b, c); }
+        static float reduceAdd(Reg a) { return _mm512_reduce_add_ps(a); }
+        static Reg loadF16(const std::uint16_t* p) { return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))); }
+        static void storeF16(std::uint16_t* p, Reg v)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+        }
+        static Reg loadBF16(const std::uint16_t* p)
+        {
+            __m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+            return _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16));
+        }
+        static void storeBF16(std::uint16_t* p, Reg v)
+        {
+            __m512i bits = _mm512_castps_si512(v);
+            __m512i odd = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+            __m512i rounded = _mm512_add_epi32(bits, _mm512_add_epi32(_mm512_set1_epi32(0x7FFF), odd));
+            __mmask16 nan = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+            rounded = _mm512_mask_mov_epi32(rounded, nan, _mm512_or_si512(bits, _mm512_set1_epi32(0x400000)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtepi32_epi16(_mm512_srli_epi32(rounded, 16)));
+        }
+    };
+
+    // AVX-512F has no byte or word arithmetic, so this is the AVX2 form (every AVX-512 CPU has
+    // AVX2, and detection requires it). CPUs with AVX512_VNNI get vpdpbusd from
+    // vector_simd_vnni.cpp instead.
+    struct Avx512Int8
+    {
+        using Reg = __m256i;
+        static constexpr std::size_t width = 32;
+
+        static Reg zero() { return _mm256_setzero_si256(); }
+        // Widens both operands to 16 bits and lets vpmaddwd multiply and add pairs into
+        // 32-bit lanes. (vpmaddubsw would skip the widening but saturates at 16 bits.)
+        static Reg dotAdd(Reg sum, const std::uint8_t* a, const std::int8_t* b)
+        {
+            for (std::size_t half = 0; half < 32; half += 16)
+            {
+                __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + half)));
+                __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + half)));
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(va, vb));
+            }
+            return sum;
+        }
+        static std::int32_t reduceAdd(Reg sum)
+        {
+            __m128i quad = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            quad = _mm_add_epi32(quad, _mm_shuffle_epi32(quad, 0x4E));
+            quad = _mm_add_epi32(quad, _mm_shuffle_epi32(quad, 0xB1));
+            return _mm_cvtsi128_si32(quad);
+        }
+    };
+
+    struct Avx512
+    {
+        using Float = Avx512Float;
+        using Int8 = Avx512Int8;
+        using Reg = __m512d;
+        static constexpr std::size_t width = 8;
+
+        static Reg load(const double* p) { return _mm512_loadu_pd(p); }
+        static void store(double* p, Reg v) { _mm512_storeu_pd(p, v); }
+        static Reg set1(double v) { return _mm512_set1_pd(v); }
+        static Reg add(Reg a, Reg b) { return _mm512_add_pd(a, b); }
+        static Reg sub(Reg a, Reg b) { return _mm512_sub_pd(a, b); }
+        static Reg mul(Reg a, Reg b) { return _mm512_mul_pd(a, b); }
+        static Reg div(Reg a, Reg b) { return _mm512_div_pd(a, b); }
+        static Reg sqrt(Reg a) { return _mm512_sqrt_pd(a); }
+        static Reg min(Reg a, Reg b) { return _mm512_min_pd(a, b); }
+        static Reg max(Reg a, Reg b) { return _mm512_max_pd(a, b); }
+        static Reg fmadd(Reg a, Reg b, Reg c) { return _mm512_fmadd_pd(a, b, c); }
+        static Reg rsqrt(Reg a) { return _mm512_rsqrt14_pd(a); }
+        static Reg zeroUnlessPositive(Reg condition, Reg v) { return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(condition, _mm512_setzero_pd(), _CMP_GT_OQ), v); }
+        static Reg selectPositive(Reg condition, Reg a, Reg b) { return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(condition, _mm512_setzero_pd(), _CMP_GT_OQ), b, a); }
+        static Reg signOf(Reg a) // AVX-512F has no floating-point and/or, so through the integer forms
+        {
+            __m512i sign = _mm512_and_si512(_mm512_castpd_si512(a), _mm512_castpd_si512(_mm512_set1_pd(-0.0)));
+            return _mm512_castsi512_pd(_mm512_or_si512(sign, _mm512_castpd_si512(_mm512_set1_pd(1.0))));
+        }
+    };
+
+#include "vector_simd_kernels.inl"
+}
+
+const BatchKernels* avx512BatchKernels()
+{
+    return SimdKernels<Avx512>::table(SimdLevel::AVX512);
+}
+
+#else
+
+const BatchKernels* avx512BatchKernels()
+{
+    return nullptr;
+}
+
+#endif
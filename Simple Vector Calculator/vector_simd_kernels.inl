@@ -0,0 +1,827 @@
+// Batch kernels written once against an instruction set traits type, then compiled
+// once per instruction set by the vector_simd_<isa>.cpp files. Only include this from
+// those files, after defining the traits type in an anonymous namespace.
+//
+// A traits type provides:
+//   Reg                  register type
+//   width                doubles per register
+//   load, store          unaligned load/store of width doubles
+//   set1                 broadcast a scalar
+//   add, sub, mul, div, sqrt, min, max
+//   fmadd(a, b, c)       a * b + c (fused where the instruction set has FMA)
+//   rsqrt                approximate 1 / sqrt (hardware estimate where available)
+//   zeroUnlessPositive(c, v)  v in lanes where c > 0, 0 elsewhere, without branching
+//   selectPositive(c, a, b)   a in lanes where c > 0, b elsewhere (including NaN c)
+//   signOf(a)            +1 or -1 with the sign bit of a, so -0.0 gives -1
+//   Int8                 traits for 8-bit dot products: Reg (32-bit lane sums), width (bytes per
+//                        step), zero, dotAdd(sum, a, b) adding width products of unsigned a and
+//                        signed b bytes into sum, reduceAdd
+//   Float                traits for float registers: Reg, width, load, store, set1, zero, add,
+//                        mul, sqrt, fmadd, reduceAdd, and loadF16, storeF16, loadBF16, storeBF16, which
+//                        convert width 16-bit values from and to the formats in half.hpp
+//
+// Each kernel runs the vector loop and finishes the remaining n % width elements in scalar code.
+// The including file has already pulled in <cmath>, <cstddef>, half.hpp and vector_simd.hpp.
+
+template <typename Isa>
+struct SimdKernels
+{
+    using Reg = typename Isa::Reg;
+    static constexpr std::size_t width = Isa::width;
+
+    static void add(const double* a, const double* b, double* out, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+            Isa::store(out + i, Isa::add(Isa::load(a + i), Isa::load(b + i)));
+        for (; i < n; ++i)
+            out[i] = a[i] + b[i];
+    }
+
+    static void subtract(const double* a, const double* b, double* out, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+            Isa::store(out + i, Isa::sub(Isa::load(a + i), Isa::load(b + i)));
+        for (; i < n; ++i)
+            out[i] = a[i] - b[i];
+    }
+
+    static void scale(const double* a, double scalar, double* out, std::size_t n)
+    {
+        Reg s = Isa::set1(scalar);
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+            Isa::store(out + i, Isa::mul(s, Isa::load(a + i)));
+        for (; i < n; ++i)
+            out[i] = scalar * a[i];
+    }
+
+    static void axpy(double a, const double* x, double* y, std::size_t n)
+    {
+        Reg s = Isa::set1(a);
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+            Isa::store(y + i, Isa::fmadd(s, Isa::load(x + i), Isa::load(y + i)));
+        for (; i < n; ++i)
+            y[i] = (a * x[i]) + y[i];
+    }
+
+    // Four accumulators hide the add latency; the summation order differs from a plain loop.
+    static double sum(const double* a, std::size_t n)
+    {
+        Reg sum0 = Isa::set1(0.0), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+        std::size_t i = 0;
+        for (; i + (4 * width) <= n; i += 4 * width)
+        {
+            sum0 = Isa::add(sum0, Isa::load(a + i));
+            sum1 = Isa::add(sum1, Isa::load(a + i + width));
+            sum2 = Isa::add(sum2, Isa::load(a + i + (2 * width)));
+            sum3 = Isa::add(sum3, Isa::load(a + i + (3 * width)));
+        }
+        for (; i + width <= n; i += width)
+            sum0 = Isa::add(sum0, Isa::load(a + i));
+        double lanes[width];
+        Isa::store(lanes, Isa::add(Isa::add(sum0, sum1), Isa::add(sum2, sum3)));
+        double result = 0.0;
+        for (std::size_t lane = 0; lane < width; ++lane)
+            result += lanes[lane];
+        for (; i < n; ++i)
+            result += a[i];
+        return result;
+    }
+
+    // Compensated sum over 32 interleaved lanes, however wide the registers: element i goes
+    // to lane i % 32 on every instruction set. Each lane adds runs of 4 of its elements
+    // plainly, then adds the run total with TwoSum, which keeps the rounding error exactly
+    // (adds and subtracts only, so nothing can be fused). Elements after the last full run
+    // get TwoSum one by one, and the lanes are folded in a fixed pairwise order. The result
+    // is the same bits on every level, with an error of at most about 3 eps sum |a[i]| +
+    // eps |sum| however large n is, at close to the speed of a plain sum.
+    static double sumCompensated(const double* a, std::size_t n)
+    {
+        constexpr std::size_t lanes = 32;
+        constexpr std::size_t run = 4;
+        static_assert(lanes % width == 0);
+        using Registers = std::make_index_sequence<lanes / width>;
+
+        Reg sums[lanes / width], errors[lanes / width];
+        std::size_t i = 0;
+        [&]<std::size_t... r>(std::index_sequence<r...>) {
+            ((sums[r] = Isa::set1(0.0), errors[r] = Isa::set1(0.0)), ...);
+            for (; i + (lanes * run) <= n; i += lanes * run)
+            {
+                ([&] {
+                    Reg v = Isa::load(a + i + (r * width));
+                    for (std::size_t k = 1; k < run; ++k)
+                        v = Isa::add(v, Isa::load(a + i + (k * lanes) + (r * width)));
+                    Reg t = Isa::add(sums[r], v);
+                    Reg z = Isa::sub(t, sums[r]);
+                    errors[r] = Isa::add(errors[r], Isa::add(Isa::sub(sums[r], Isa::sub(t, z)), Isa::sub(v, z)));
+                    sums[r] = t;
+                }(), ...);
+            }
+        }(Registers{});
+
+        double s[lanes], c[lanes];
+        for (std::size_t r = 0; r < lanes / width; ++r)
+        {
+            Isa::store(s + (r * width), sums[r]);
+            Isa::store(c + (r * width), errors[r]);
+        }
+        auto twoSum = [](double& sum, double& error, double v) {
+            double t = sum + v;
+            double z = t - sum;
+            error += (sum - (t - z)) + (v - z);
+            sum = t;
+        };
+        for (; i < n; ++i)
+            twoSum(s[i % lanes], c[i % lanes], a[i]);
+        for (std::size_t half = lanes / 2; half > 0; half /= 2)
+        {
+            for (std::size_t lane = 0; lane < half; ++lane)
+            {
+                c[lane] += c[lane + half];
+                twoSum(s[lane], c[lane], s[lane + half]);
+            }
+        }
+        return s[0] + c[0];
+    }
+
+    static void minMax(const double* a, std::size_t n, double* low, double* high)
+    {
+        Reg lo = Isa::set1(*low), hi = Isa::set1(*high);
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg v = Isa::load(a + i);
+            lo = Isa::min(lo, v);
+            hi = Isa::max(hi, v);
+        }
+        double lows[width], highs[width];
+        Isa::store(lows, lo);
+        Isa::store(highs, hi);
+        for (std::size_t lane = 0; lane < width; ++lane)
+        {
+            *low = lows[lane] < *low ? lows[lane] : *low;
+            *high = highs[lane] > *high ? highs[lane] : *high;
+        }
+        for (; i < n; ++i)
+        {
+            *low = a[i] < *low ? a[i] : *low;
+            *high = a[i] > *high ? a[i] : *high;
+        }
+    }
+
+    static void moments3(const double* origin, const double* x, const double* y, const double* z,
+                         std::size_t n, double* out)
+    {
+        const Reg ox = Isa::set1(origin[0]), oy = Isa::set1(origin[1]), oz = Isa::set1(origin[2]);
+        Reg sums[9];
+        for (Reg& sum : sums)
+            sum = Isa::set1(0.0);
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg dx = Isa::sub(Isa::load(x + i), ox), dy = Isa::sub(Isa::load(y + i), oy), dz = Isa::sub(Isa::load(z + i), oz);
+            sums[0] = Isa::add(sums[0], dx);
+            sums[1] = Isa::add(sums[1], dy);
+            sums[2] = Isa::add(sums[2], dz);
+            sums[3] = Isa::fmadd(dx, dx, sums[3]);
+            sums[4] = Isa::fmadd(dx, dy, sums[4]);
+            sums[5] = Isa::fmadd(dx, dz, sums[5]);
+            sums[6] = Isa::fmadd(dy, dy, sums[6]);
+            sums[7] = Isa::fmadd(dy, dz, sums[7]);
+            sums[8] = Isa::fmadd(dz, dz, sums[8]);
+        }
+        for (std::size_t k = 0; k < 9; ++k)
+        {
+            double lanes[width];
+            Isa::store(lanes, sums[k]);
+            out[k] = 0.0;
+            for (std::size_t lane = 0; lane < width; ++lane)
+                out[k] += lanes[lane];
+        }
+        for (; i < n; ++i)
+        {
+            double dx = x[i] - origin[0], dy = y[i] - origin[1], dz = z[i] - origin[2];
+            out[0] += dx;
+            out[1] += dy;
+            out[2] += dz;
+            out[3] += dx * dx;
+            out[4] += dx * dy;
+            out[5] += dx * dz;
+            out[6] += dy * dy;
+            out[7] += dy * dz;
+            out[8] += dz * dz;
+        }
+    }
+
+    static void dotProduct3(const double* ax, const double* ay, const double* az,
+                            const double* bx, const double* by, const double* bz,
+                            double* out, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg dot = Isa::mul(Isa::load(ax + i), Isa::load(bx + i));
+            dot = Isa::fmadd(Isa::load(ay + i), Isa::load(by + i), dot);
+            dot = Isa::fmadd(Isa::load(az + i), Isa::load(bz + i), dot);
+            Isa::store(out + i, dot);
+        }
+        for (; i < n; ++i)
+            out[i] = (ax[i] * bx[i]) + (ay[i] * by[i]) + (az[i] * bz[i]);
+    }
+
+    static void crossProduct3(const double* ax, const double* ay, const double* az,
+                              const double* bx, const double* by, const double* bz,
+                              double* rx, double* ry, double* rz, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg x1 = Isa::load(ax + i), y1 = Isa::load(ay + i), z1 = Isa::load(az + i);
+            Reg x2 = Isa::load(bx + i), y2 = Isa::load(by + i), z2 = Isa::load(bz + i);
+            Reg cx = Isa::sub(Isa::mul(y1, z2), Isa::mul(z1, y2));
+            Reg cy = Isa::sub(Isa::mul(z1, x2), Isa::mul(x1, z2));
+            Reg cz = Isa::sub(Isa::mul(x1, y2), Isa::mul(y1, x2));
+            Isa::store(rx + i, cx);
+            Isa::store(ry + i, cy);
+            Isa::store(rz + i, cz);
+        }
+        for (; i < n; ++i)
+        {
+            double cx = (ay[i] * bz[i]) - (az[i] * by[i]);
+            double cy = (az[i] * bx[i]) - (ax[i] * bz[i]);
+            double cz = (ax[i] * by[i]) - (ay[i] * bx[i]);
+            rx[i] = cx;
+            ry[i] = cy;
+            rz[i] = cz;
+        }
+    }
+
+    static void magnitude3(const double* x, const double* y, const double* z, double* out, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg vx = Isa::load(x + i), vy = Isa::load(y + i), vz = Isa::load(z + i);
+            Reg lengthSquared = Isa::fmadd(vz, vz, Isa::fmadd(vy, vy, Isa::mul(vx, vx)));
+            Isa::store(out + i, Isa::sqrt(lengthSquared));
+        }
+        for (; i < n; ++i)
+            out[i] = std::sqrt((x[i] * x[i]) + (y[i] * y[i]) + (z[i] * z[i]));
+    }
+
+    static void distanceSquared3(double px, double py, double pz,
+                                 const double* x, const double* y, const double* z,
+                                 double* out, std::size_t n)
+    {
+        Reg vpx = Isa::set1(px), vpy = Isa::set1(py), vpz = Isa::set1(pz);
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg dx = Isa::sub(Isa::load(x + i), vpx);
+            Reg dy = Isa::sub(Isa::load(y + i), vpy);
+            Reg dz = Isa::sub(Isa::load(z + i), vpz);
+            Isa::store(out + i, Isa::fmadd(dz, dz, Isa::fmadd(dy, dy, Isa::mul(dx, dx))));
+        }
+        for (; i < n; ++i)
+        {
+            double dx = x[i] - px, dy = y[i] - py, dz = z[i] - pz;
+            out[i] = (dx * dx) + (dy * dy) + (dz * dz);
+        }
+    }
+
+    // Zero-length vectors come out as zero: the NaN from 0 / 0 is masked off afterwards.
+    static void normalize3(const double* x, const double* y, const double* z,
+                           double* rx, double* ry, double* rz, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg vx = Isa::load(x + i), vy = Isa::load(y + i), vz = Isa::load(z + i);
+            Reg lengthSquared = Isa::fmadd(vz, vz, Isa::fmadd(vy, vy, Isa::mul(vx, vx)));
+            Reg magnitude = Isa::sqrt(lengthSquared);
+            Isa::store(rx + i, Isa::zeroUnlessPositive(lengthSquared, Isa::div(vx, magnitude)));
+            Isa::store(ry + i, Isa::zeroUnlessPositive(lengthSquared, Isa::div(vy, magnitude)));
+            Isa::store(rz + i, Isa::zeroUnlessPositive(lengthSquared, Isa::div(vz, magnitude)));
+        }
+        for (; i < n; ++i)
+        {
+            double lengthSquared = (x[i] * x[i]) + (y[i] * y[i]) + (z[i] * z[i]);
+            double magnitude = std::sqrt(lengthSquared);
+            bool nonZero = lengthSquared > 0.0;
+            rx[i] = nonZero ? x[i] / magnitude : 0.0;
+            ry[i] = nonZero ? y[i] / magnitude : 0.0;
+            rz[i] = nonZero ? z[i] / magnitude : 0.0;
+        }
+    }
+
+    // Hardware rsqrt estimate refined by one Newton-Raphson step, y * (1.5 - 0.5 * l * y * y),
+    // with (l y) y rather than l (y y) so no product leaves double range for normal l.
+    static void normalize3Fast(const double* x, const double* y, const double* z,
+                               double* rx, double* ry, double* rz, std::size_t n)
+    {
+        const Reg half = Isa::set1(0.5);
+        const Reg threeHalves = Isa::set1(1.5);
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg vx = Isa::load(x + i), vy = Isa::load(y + i), vz = Isa::load(z + i);
+            Reg lengthSquared = Isa::fmadd(vz, vz, Isa::fmadd(vy, vy, Isa::mul(vx, vx)));
+            Reg estimate = Isa::rsqrt(lengthSquared);
+            Reg halfLengthSquared = Isa::mul(half, lengthSquared);
+            Reg correction = Isa::sub(threeHalves, Isa::mul(Isa::mul(halfLengthSquared, estimate), estimate));
+            Reg inverse = Isa::zeroUnlessPositive(lengthSquared, Isa::mul(estimate, correction));
+            Isa::store(rx + i, Isa::mul(vx, inverse));
+            Isa::store(ry + i, Isa::mul(vy, inverse));
+            Isa::store(rz + i, Isa::mul(vz, inverse));
+        }
+        for (; i < n; ++i)
+        {
+            double lengthSquared = (x[i] * x[i]) + (y[i] * y[i]) + (z[i] * z[i]);
+            double inverse = lengthSquared > 0.0 ? 1.0 / std::sqrt(lengthSquared) : 0.0;
+            rx[i] = x[i] * inverse;
+            ry[i] = y[i] * inverse;
+            rz[i] = z[i] * inverse;
+        }
+    }
+
+    static void projectAxis3(const double* axis, double c, double k, const double* x, const double* y, const double* z,
+                             double* rx, double* ry, double* rz, std::size_t n)
+    {
+        Reg ax = Isa::set1(axis[0]), ay = Isa::set1(axis[1]), az = Isa::set1(axis[2]);
+        Reg vc = Isa::set1(c), vk = Isa::set1(k);
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg px = Isa::load(x + i), py = Isa::load(y + i), pz = Isa::load(z + i);
+            Reg f = Isa::mul(vk, Isa::fmadd(az, pz, Isa::fmadd(ay, py, Isa::mul(ax, px))));
+            Isa::store(rx + i, Isa::fmadd(f, ax, Isa::mul(vc, px)));
+            Isa::store(ry + i, Isa::fmadd(f, ay, Isa::mul(vc, py)));
+            Isa::store(rz + i, Isa::fmadd(f, az, Isa::mul(vc, pz)));
+        }
+        for (; i < n; ++i)
+        {
+            double px = x[i], py = y[i], pz = z[i];
+            double f = k * ((axis[2] * pz) + ((axis[1] * py) + (axis[0] * px)));
+            rx[i] = (f * axis[0]) + (c * px);
+            ry[i] = (f * axis[1]) + (c * py);
+            rz[i] = (f * axis[2]) + (c * pz);
+        }
+    }
+
+    // r = M p + t for the row-major 3x4 matrix m = [M | t].
+    static void transform3(const double* m, const double* x, const double* y, const double* z,
+                           double* rx, double* ry, double* rz, std::size_t n)
+    {
+        Reg m00 = Isa::set1(m[0]), m01 = Isa::set1(m[1]), m02 = Isa::set1(m[2]), t0 = Isa::set1(m[3]);
+        Reg m10 = Isa::set1(m[4]), m11 = Isa::set1(m[5]), m12 = Isa::set1(m[6]), t1 = Isa::set1(m[7]);
+        Reg m20 = Isa::set1(m[8]), m21 = Isa::set1(m[9]), m22 = Isa::set1(m[10]), t2 = Isa::set1(m[11]);
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg px = Isa::load(x + i), py = Isa::load(y + i), pz = Isa::load(z + i);
+            Isa::store(rx + i, Isa::fmadd(m02, pz, Isa::fmadd(m01, py, Isa::fmadd(m00, px, t0))));
+            Isa::store(ry + i, Isa::fmadd(m12, pz, Isa::fmadd(m11, py, Isa::fmadd(m10, px, t1))));
+            Isa::store(rz + i, Isa::fmadd(m22, pz, Isa::fmadd(m21, py, Isa::fmadd(m20, px, t2))));
+        }
+        for (; i < n; ++i)
+        {
+            double px = x[i], py = y[i], pz = z[i];
+            rx[i] = (m[2] * pz) + ((m[1] * py) + ((m[0] * px) + m[3]));
+            ry[i] = (m[6] * pz) + ((m[5] * py) + ((m[4] * px) + m[7]));
+            rz[i] = (m[10] * pz) + ((m[9] * py) + ((m[8] * px) + m[11]));
+        }
+    }
+
+    // Rotation matrices of unit quaternions (x, y, z, w), written to nine row-major arrays
+    // m[0] = m00, m[1] = m01, ... m[8] = m22.
+    static void quaternionToMatrix3(const double* qx, const double* qy, const double* qz, const double* qw,
+                                    double* const* m, std::size_t n)
+    {
+        const Reg one = Isa::set1(1.0), two = Isa::set1(2.0);
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg x = Isa::load(qx + i), y = Isa::load(qy + i), z = Isa::load(qz + i), w = Isa::load(qw + i);
+            Reg x2 = Isa::mul(x, two), y2 = Isa::mul(y, two), z2 = Isa::mul(z, two);
+            Reg xx = Isa::mul(x, x2), yy = Isa::mul(y, y2), zz = Isa::mul(z, z2);
+            Reg xy = Isa::mul(x, y2), xz = Isa::mul(x, z2), yz = Isa::mul(y, z2);
+            Reg wx = Isa::mul(w, x2), wy = Isa::mul(w, y2), wz = Isa::mul(w, z2);
+            Isa::store(m[0] + i, Isa::sub(one, Isa::add(yy, zz)));
+            Isa::store(m[1] + i, Isa::sub(xy, wz));
+            Isa::store(m[2] + i, Isa::add(xz, wy));
+            Isa::store(m[3] + i, Isa::add(xy, wz));
+            Isa::store(m[4] + i, Isa::sub(one, Isa::add(xx, zz)));
+            Isa::store(m[5] + i, Isa::sub(yz, wx));
+            Isa::store(m[6] + i, Isa::sub(xz, wy));
+            Isa::store(m[7] + i, Isa::add(yz, wx));
+            Isa::store(m[8] + i, Isa::sub(one, Isa::add(xx, yy)));
+        }
+        for (; i < n; ++i)
+        {
+            double x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+            double x2 = x * 2.0, y2 = y * 2.0, z2 = z * 2.0;
+            double xx = x * x2, yy = y * y2, zz = z * z2;
+            double xy = x * y2, xz = x * z2, yz = y * z2;
+            double wx = w * x2, wy = w * y2, wz = w * z2;
+            m[0][i] = 1.0 - (yy + zz);
+            m[1][i] = xy - wz;
+            m[2][i] = xz + wy;
+            m[3][i] = xy + wz;
+            m[4][i] = 1.0 - (xx + zz);
+            m[5][i] = yz - wx;
+            m[6][i] = xz - wy;
+            m[7][i] = yz + wx;
+            m[8][i] = 1.0 - (xx + yy);
+        }
+    }
+
+    // Right-handed orthonormal frames written as the columns tangent, bitangent, normal of
+    // nine row-major arrays, as in quaternionToMatrix3. The normal is normalized (a zero one to
+    // zero, as in normalize3). Without tangents, or where a tangent is zero or within about
+    // 1e-6 radians of the normal, the tangent and bitangent are the branchless basis of Duff
+    // et al., "Building an Orthonormal Basis, Revisited" (2017). Otherwise bitangent =
+    // normalize(normal x tangent) and tangent = bitangent x normal, i.e. Gram-Schmidt on the
+    // tangent.
+    template <bool WithTangents>
+    static void frames3(const double* nx, const double* ny, const double* nz,
+                        const double* tx, const double* ty, const double* tz, double* const* m, std::size_t n)
+    {
+        const Reg one = Isa::set1(1.0), minusOne = Isa::set1(-1.0), tolerance = Isa::set1(1e-12);
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg x = Isa::load(nx + i), y = Isa::load(ny + i), z = Isa::load(nz + i);
+            Reg lengthSquared = Isa::fmadd(z, z, Isa::fmadd(y, y, Isa::mul(x, x)));
+            Reg inverse = Isa::div(one, Isa::sqrt(lengthSquared));
+            x = Isa::zeroUnlessPositive(lengthSquared, Isa::mul(x, inverse));
+            y = Isa::zeroUnlessPositive(lengthSquared, Isa::mul(y, inverse));
+            z = Isa::zeroUnlessPositive(lengthSquared, Isa::mul(z, inverse));
+
+            Reg sign = Isa::signOf(z);
+            Reg a = Isa::div(minusOne, Isa::add(sign, z));
+            Reg b = Isa::mul(Isa::mul(x, y), a);
+            Reg sx = Isa::mul(sign, x);
+            Reg t0 = Isa::fmadd(Isa::mul(sx, x), a, one), t1 = Isa::mul(sign, b), t2 = Isa::sub(Isa::set1(0.0), sx);
+            Reg b0 = b, b1 = Isa::fmadd(Isa::mul(y, y), a, sign), b2 = Isa::sub(Isa::set1(0.0), y);
+
+            if constexpr (WithTangents)
+            {
+                Reg ux = Isa::load(tx + i), uy = Isa::load(ty + i), uz = Isa::load(tz + i);
+                Reg cx = Isa::sub(Isa::mul(y, uz), Isa::mul(z, uy));
+                Reg cy = Isa::sub(Isa::mul(z, ux), Isa::mul(x, uz));
+                Reg cz = Isa::sub(Isa::mul(x, uy), Isa::mul(y, ux));
+                Reg crossSquared = Isa::fmadd(cz, cz, Isa::fmadd(cy, cy, Isa::mul(cx, cx)));
+                Reg tangentSquared = Isa::fmadd(uz, uz, Isa::fmadd(uy, uy, Isa::mul(ux, ux)));
+                Reg keep = Isa::sub(crossSquared, Isa::mul(tolerance, tangentSquared));
+                Reg crossInverse = Isa::div(one, Isa::sqrt(crossSquared));
+                cx = Isa::mul(cx, crossInverse);
+                cy = Isa::mul(cy, crossInverse);
+                cz = Isa::mul(cz, crossInverse);
+                b0 = Isa::selectPositive(keep, cx, b0);
+                b1 = Isa::selectPositive(keep, cy, b1);
+                b2 = Isa::selectPositive(keep, cz, b2);
+                t0 = Isa::selectPositive(keep, Isa::sub(Isa::mul(cy, z), Isa::mul(cz, y)), t0);
+                t1 = Isa::selectPositive(keep, Isa::sub(Isa::mul(cz, x), Isa::mul(cx, z)), t1);
+                t2 = Isa::selectPositive(keep, Isa::sub(Isa::mul(cx, y), Isa::mul(cy, x)), t2);
+            }
+
+            Isa::store(m[0] + i, t0);
+            Isa::store(m[1] + i, b0);
+            Isa::store(m[2] + i, x);
+            Isa::store(m[3] + i, t1);
+            Isa::store(m[4] + i, b1);
+            Isa::store(m[5] + i, y);
+            Isa::store(m[6] + i, t2);
+            Isa::store(m[7] + i, b2);
+            Isa::store(m[8] + i, z);
+        }
+        for (; i < n; ++i)
+        {
+            double x = nx[i], y = ny[i], z = nz[i];
+            double lengthSquared = (x * x) + (y * y) + (z * z);
+            bool nonZero = lengthSquared > 0.0;
+            double inverse = 1.0 / std::sqrt(lengthSquared);
+            x = nonZero ? x * inverse : 0.0;
+            y = nonZero ? y * inverse : 0.0;
+            z = nonZero ? z * inverse : 0.0;
+
+            double sign = std::copysign(1.0, z);
+            double a = -1.0 / (sign + z);
+            double b = x * y * a;
+            double t0 = 1.0 + (sign * x * x * a), t1 = sign * b, t2 = -sign * x;
+            double b0 = b, b1 = sign + (y * y * a), b2 = -y;
+
+            if constexpr (WithTangents)
+            {
+                double ux = tx[i], uy = ty[i], uz = tz[i];
+                double cx = (y * uz) - (z * uy), cy = (z * ux) - (x * uz), cz = (x * uy) - (y * ux);
+                double crossSquared = (cx * cx) + (cy * cy) + (cz * cz);
+                double tangentSquared = (ux * ux) + (uy * uy) + (uz * uz);
+                if (crossSquared > 1e-12 * tangentSquared)
+                {
+                    double crossInverse = 1.0 / std::sqrt(crossSquared);
+                    b0 = cx * crossInverse;
+                    b1 = cy * crossInverse;
+                    b2 = cz * crossInverse;
+                    t0 = (b1 * z) - (b2 * y);
+                    t1 = (b2 * x) - (b0 * z);
+                    t2 = (b0 * y) - (b1 * x);
+                }
+            }
+
+            m[0][i] = t0;
+            m[1][i] = b0;
+            m[2][i] = x;
+            m[3][i] = t1;
+            m[4][i] = b1;
+            m[5][i] = y;
+            m[6][i] = t2;
+            m[7][i] = b2;
+            m[8][i] = z;
+        }
+    }
+
+    static void orthonormalBasis3(const double* nx, const double* ny, const double* nz, double* const* m, std::size_t n)
+    {
+        frames3<false>(nx, ny, nz, nullptr, nullptr, nullptr, m, n);
+    }
+
+    static void orthonormalFrame3(const double* nx, const double* ny, const double* nz,
+                                  const double* tx, const double* ty, const double* tz, double* const* m, std::size_t n)
+    {
+        frames3<true>(nx, ny, nz, tx, ty, tz, m, n);
+    }
+
+    // r[i] = M[i] p[i], with each element's 3x3 matrix in nine row-major arrays as above.
+    static void transform3Each(const double* const* m, const double* x, const double* y, const double* z,
+                               double* rx, double* ry, double* rz, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            Reg px = Isa::load(x + i), py = Isa::load(y + i), pz = Isa::load(z + i);
+            Reg ox = Isa::fmadd(Isa::load(m[2] + i), pz, Isa::fmadd(Isa::load(m[1] + i), py, Isa::mul(Isa::load(m[0] + i), px)));
+            Reg oy = Isa::fmadd(Isa::load(m[5] + i), pz, Isa::fmadd(Isa::load(m[4] + i), py, Isa::mul(Isa::load(m[3] + i), px)));
+            Reg oz = Isa::fmadd(Isa::load(m[8] + i), pz, Isa::fmadd(Isa::load(m[7] + i), py, Isa::mul(Isa::load(m[6] + i), px)));
+            Isa::store(rx + i, ox);
+            Isa::store(ry + i, oy);
+            Isa::store(rz + i, oz);
+        }
+        for (; i < n; ++i)
+        {
+            double px = x[i], py = y[i], pz = z[i];
+            double ox = (m[2][i] * pz) + ((m[1][i] * py) + (m[0][i] * px));
+            double oy = (m[5][i] * pz) + ((m[4][i] * py) + (m[3][i] * px));
+            double oz = (m[8][i] * pz) + ((m[7][i] * py) + (m[6][i] * px));
+            rx[i] = ox;
+            ry[i] = oy;
+            rz[i] = oz;
+        }
+    }
+
+    // float <-> 16-bit conversions, one register of elements per step.
+    static void widenF16(const std::uint16_t* in, float* out, std::size_t n)
+    {
+        using F = typename Isa::Float;
+        std::size_t i = 0;
+        for (; i + F::width <= n; i += F::width)
+            F::store(out + i, F::loadF16(in + i));
+        for (; i < n; ++i)
+            out[i] = halfToFloat(in[i]);
+    }
+
+    static void narrowF16(const float* in, std::uint16_t* out, std::size_t n)
+    {
+        using F = typename Isa::Float;
+        std::size_t i = 0;
+        for (; i + F::width <= n; i += F::width)
+            F::storeF16(out + i, F::load(in + i));
+        for (; i < n; ++i)
+            out[i] = floatToHalf(in[i]);
+    }
+
+    static void widenBF16(const std::uint16_t* in, float* out, std::size_t n)
+    {
+        using F = typename Isa::Float;
+        std::size_t i = 0;
+        for (; i + F::width <= n; i += F::width)
+            F::store(out + i, F::loadBF16(in + i));
+        for (; i < n; ++i)
+            out[i] = bfloat16ToFloat(in[i]);
+    }
+
+    static void narrowBF16(const float* in, std::uint16_t* out, std::size_t n)
+    {
+        using F = typename Isa::Float;
+        std::size_t i = 0;
+        for (; i + F::width <= n; i += F::width)
+            F::storeBF16(out + i, F::load(in + i));
+        for (; i < n; ++i)
+            out[i] = floatToBFloat16(in[i]);
+    }
+
+    template <bool BFloat>
+    static typename Isa::Float::Reg loadHalf(const std::uint16_t* p)
+    {
+        if constexpr (BFloat)
+            return Isa::Float::loadBF16(p);
+        else
+            return Isa::Float::loadF16(p);
+    }
+
+    template <bool BFloat>
+    static float halfValue(std::uint16_t value)
+    {
+        return BFloat ? bfloat16ToFloat(value) : halfToFloat(value);
+    }
+
+    // dotProduct3 and magnitude3 on 16-bit components (bfloat16 when BFloat), widened in
+    // registers and computed in float without a float copy of the inputs.
+    template <bool BFloat>
+    static void dotProduct3Half(const std::uint16_t* ax, const std::uint16_t* ay, const std::uint16_t* az,
+                                const std::uint16_t* bx, const std::uint16_t* by, const std::uint16_t* bz,
+                                float* out, std::size_t n)
+    {
+        using F = typename Isa::Float;
+        std::size_t i = 0;
+        for (; i + F::width <= n; i += F::width)
+        {
+            typename F::Reg r = F::mul(loadHalf<BFloat>(ax + i), loadHalf<BFloat>(bx + i));
+            r = F::fmadd(loadHalf<BFloat>(ay + i), loadHalf<BFloat>(by + i), r);
+            r = F::fmadd(loadHalf<BFloat>(az + i), loadHalf<BFloat>(bz + i), r);
+            F::store(out + i, r);
+        }
+        for (; i < n; ++i)
+        {
+            out[i] = (halfValue<BFloat>(ax[i]) * halfValue<BFloat>(bx[i])) + (halfValue<BFloat>(ay[i]) * halfValue<BFloat>(by[i])) +
+                     (halfValue<BFloat>(az[i]) * halfValue<BFloat>(bz[i]));
+        }
+    }
+
+    template <bool BFloat>
+    static void magnitude3Half(const std::uint16_t* x, const std::uint16_t* y, const std::uint16_t* z, float* out, std::size_t n)
+    {
+        using F = typename Isa::Float;
+        std::size_t i = 0;
+        for (; i + F::width <= n; i += F::width)
+        {
+            typename F::Reg vx = loadHalf<BFloat>(x + i), vy = loadHalf<BFloat>(y + i), vz = loadHalf<BFloat>(z + i);
+            F::store(out + i, F::sqrt(F::fmadd(vz, vz, F::fmadd(vy, vy, F::mul(vx, vx)))));
+        }
+        for (; i < n; ++i)
+        {
+            float vx = halfValue<BFloat>(x[i]), vy = halfValue<BFloat>(y[i]), vz = halfValue<BFloat>(z[i]);
+            out[i] = std::sqrt((vx * vx) + (vy * vy) + (vz * vz));
+        }
+    }
+
+    static void dotProduct3F32(const float* ax, const float* ay, const float* az,
+                               const float* bx, const float* by, const float* bz, float* out, std::size_t n)
+    {
+        using F = typename Isa::Float;
+        std::size_t i = 0;
+        for (; i + F::width <= n; i += F::width)
+        {
+            typename F::Reg r = F::mul(F::load(ax + i), F::load(bx + i));
+            r = F::fmadd(F::load(ay + i), F::load(by + i), r);
+            r = F::fmadd(F::load(az + i), F::load(bz + i), r);
+            F::store(out + i, r);
+        }
+        for (; i < n; ++i)
+            out[i] = (ax[i] * bx[i]) + (ay[i] * by[i]) + (az[i] * bz[i]);
+    }
+
+    // Two accumulators, each step adding Int8::width byte products.
+    static std::int32_t dotProductU8I8(const std::uint8_t* a, const std::int8_t* b, std::size_t n)
+    {
+        using I = typename Isa::Int8;
+        typename I::Reg sum0 = I::zero(), sum1 = I::zero();
+        std::size_t i = 0;
+        for (; i + (2 * I::width) <= n; i += 2 * I::width)
+        {
+            sum0 = I::dotAdd(sum0, a + i, b + i);
+            sum1 = I::dotAdd(sum1, a + i + I::width, b + i + I::width);
+        }
+        for (; i + I::width <= n; i += I::width)
+            sum0 = I::dotAdd(sum0, a + i, b + i);
+        std::int32_t result = I::reduceAdd(sum0) + I::reduceAdd(sum1);
+        for (; i < n; ++i)
+            result += a[i] * b[i];
+        return result;
+    }
+
+    // Dense float dot product for long vectors. Four independent accumulators hide the
+    // add latency; the summation order differs from a plain loop.
+    static float dotProductF32(const float* a, const float* b, std::size_t n)
+    {
+        using F = typename Isa::Float;
+        constexpr std::size_t step = F::width;
+        typename F::Reg sum0 = F::zero(), sum1 = F::zero(), sum2 = F::zero(), sum3 = F::zero();
+        std::size_t i = 0;
+        for (; i + (4 * step) <= n; i += 4 * step)
+        {
+            sum0 = F::fmadd(F::load(a + i), F::load(b + i), sum0);
+            sum1 = F::fmadd(F::load(a + i + step), F::load(b + i + step), sum1);
+            sum2 = F::fmadd(F::load(a + i + (2 * step)), F::load(b + i + (2 * step)), sum2);
+            sum3 = F::fmadd(F::load(a + i + (3 * step)), F::load(b + i + (3 * step)), sum3);
+        }
+        for (; i + step <= n; i += step)
+            sum0 = F::fmadd(F::load(a + i), F::load(b + i), sum0);
+        float result = F::reduceAdd(F::add(F::add(sum0, sum1), F::add(sum2, sum3)));
+        for (; i < n; ++i)
+            result += a[i] * b[i];
+        return result;
+    }
+
+    // Queries dot products against n column-stored vectors, two registers of vectors at a
+    // time. Every column load feeds Queries fused multiply-adds into register accumulators;
+    // the per-query steps are unrolled with a fold so the accumulators stay in registers.
+    template <std::size_t Queries>
+    static void columnDotProducts(const float* const* columns, const float* queries, std::size_t dims,
+                                  float* out, std::size_t n)
+    {
+        using F = typename Isa::Float;
+        using Indices = std::make_index_sequence<Queries>;
+        constexpr std::size_t step = F::width;
+        std::size_t i = 0;
+        for (; i + (2 * step) <= n; i += 2 * step)
+        {
+            typename F::Reg low[Queries], high[Queries];
+            [&]<std::size_t... q>(std::index_sequence<q...>) {
+                ((low[q] = F::zero(), high[q] = F::zero()), ...);
+                for (std::size_t axis = 0; axis < dims; ++axis)
+                {
+                    typename F::Reg a = F::load(columns[axis] + i);
+                    typename F::Reg b = F::load(columns[axis] + i + step);
+                    ((low[q] = F::fmadd(F::set1(queries[(q * dims) + axis]), a, low[q]),
+                      high[q] = F::fmadd(F::set1(queries[(q * dims) + axis]), b, high[q])), ...);
+                }
+                ((F::store(out + (q * n) + i, low[q]), F::store(out + (q * n) + i + step, high[q])), ...);
+            }(Indices{});
+        }
+        for (; i < n; ++i)
+        {
+            for (std::size_t q = 0; q < Queries; ++q)
+            {
+                float sum = 0.0f;
+                for (std::size_t axis = 0; axis < dims; ++axis)
+                    sum += queries[(q * dims) + axis] * columns[axis][i];
+                out[(q * n) + i] = sum;
+            }
+        }
+    }
+
+    static void columnDotProductsF32(const float* const* columns, const float* queries, std::size_t queryCount,
+                                     std::size_t dims, float* out, std::size_t n)
+    {
+        std::size_t q = 0;
+        for (; q + 4 <= queryCount; q += 4)
+            columnDotProducts<4>(columns, queries + (q * dims), dims, out + (q * n), n);
+        for (; q < queryCount; ++q)
+            columnDotProducts<1>(columns, queries + (q * dims), dims, out + (q * n), n);
+    }
+
+    static const BatchKernels* table(SimdLevel level)
+    {
+        static const BatchKernels kernels = {
+            level,
+            &add,
+            &subtract,
+            &scale,
+            &axpy,
+            &sum,
+            &sumCompensated,
+            &minMax,
+            &moments3,
+            &dotProduct3,
+            &crossProduct3,
+            &magnitude3,
+            &distanceSquared3,
+            &normalize3,
+            &normalize3Fast,
+            &projectAxis3,
+            &transform3,
+            &quaternionToMatrix3,
+            &transform3Each,
+            &orthonormalBasis3,
+            &orthonormalFrame3,
+            &widenF16,
+            &narrowF16,
+            &widenBF16,
+            &narrowBF16,
+            &dotProduct3Half<false>,
+            &dotProduct3Half<true>,
+            &magnitude3Half<false>,
+            &magnitude3Half<true>,
+            &dotProduct3F32,
+            &dotProductU8I8,
+            &dotProductF32,
+            &columnDotProductsF32,
+        };
+        return &kernels;
+    }
+};
@@ -0,0 +1,71 @@
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#include "half.hpp"
+#include "vector_simd.hpp"
+
+// Portable fallback, one element per "register". Always available.
+namespace
+{
+    struct ScalarFloat
+    {
+        using Reg = float;
+        static constexpr std::size_t width = 1;
+
+        static Reg load(const float* p) { return *p; }
+        static void store(float* p, Reg v) { *p = v; }
+        static Reg set1(float v) { return v; }
+        static Reg zero() { return 0.0f; }
+        static Reg add(Reg a, Reg b) { return a + b; }
+        static Reg mul(Reg a, Reg b) { return a * b; }
+        static Reg sqrt(Reg a) { return std::sqrt(a); }
+        static Reg fmadd(Reg a, Reg b, Reg c) { return (a * b) + c; }
+        static float reduceAdd(Reg a) { return a; }
+        static Reg loadF16(const std::uint16_t* p) { return halfToFloat(*p); }
+        static void storeF16(std::uint16_t* p, Reg v) { *p = floatToHalf(v); }
+        static Reg loadBF16(const std::uint16_t* p) { return bfloat16ToFloat(*p); }
+        static void storeBF16(std::uint16_t* p, Reg v) { *p = floatToBFloat16(v); }
+    };
+
+    struct ScalarInt8
+    {
+        using Reg = std::int32_t;
+        static constexpr std::size_t width = 1;
+
+        static Reg zero() { return 0; }
+        static Reg dotAdd(Reg sum, const std::uint8_t* a, const std::int8_t* b) { return sum + (*a * *b); }
+        static std::int32_t reduceAdd(Reg sum) { return sum; }
+    };
+
+    struct Scalar
+    {
+        using Float = ScalarFloat;
+        using Int8 = ScalarInt8;
+        using Reg = double;
+        static constexpr std::size_t width = 1;
+
+        static Reg load(const double* p) { return *p; }
+        static void store(double* p, Reg v) { *p = v; }
+        static Reg set1(double v) { return v; }
+        static Reg add(Reg a, Reg b) { return a + b; }
+        static Reg sub(Reg a, Reg b) { return a - b; }
+        static Reg mul(Reg a, Reg b) { return a * b; }
+        static Reg div(Reg a, Reg b) { return a / b; }
+        static Reg sqrt(Reg a) { return std::sqrt(a); }
+        static Reg min(Reg a, Reg b) { return b < a ? b : a; }
+        static Reg max(Reg a, Reg b) { return a < b ? b : a; }
+        static Reg fmadd(Reg a, Reg b, Reg c) { return (a * b) + c; }
+        static Reg rsqrt(Reg a) { return 1.0 / std::sqrt(a); } // no estimate instruction, so exact
+        static Reg zeroUnlessPositive(Reg condition, Reg v) { return condition > 0.0 ? v : 0.0; }
+        static Reg selectPositive(Reg condition, Reg a, Reg b) { return condition > 0.0 ? a : b; }
+        static Reg signOf(Reg a) { return std::copysign(1.0, a); }
+    };
+
+#include "vector_simd_kernels.inl"
+}
+
+const BatchKernels* scalarBatchKernels()
+{
+    return SimdKernels<Scalar>::table(SimdLevel::Scalar);
+}
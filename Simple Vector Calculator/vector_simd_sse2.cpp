@@ -0,0 +1,142 @@
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#include "half.hpp"
+#include "vector_simd.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+namespace
+{
+    struct Sse2Float
+    {
+        using Reg = __m128;
+        static constexpr std::size_t width = 4;
+
+        static Reg load(const float* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, Reg v) { _mm_storeu_ps(p, v); }
+        static Reg set1(float v) { return _mm_set1_ps(v); }
+        static Reg zero() { return _mm_setzero_ps(); }
+        static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+        static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+        static Reg sqrt(Reg a) { return _mm_sqrt_ps(a); }
+        static Reg fmadd(Reg a, Reg b, Reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+        static float reduceAdd(Reg a)
+        {
+            Reg pairs = _mm_add_ps(a, _mm_movehl_ps(a, a));
+            return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+        }
+        // No F16C at this level, so half precision goes through the portable conversions.
+        static Reg loadF16(const std::uint16_t* p)
+        {
+            return _mm_setr_ps(halfToFloat(p[0]), halfToFloat(p[1]), halfToFloat(p[2]), halfToFloat(p[3]));
+        }
+        static void storeF16(std::uint16_t* p, Reg v)
+        {
+            float lanes[width];
+            _mm_storeu_ps(lanes, v);
+            for (std::size_t lane = 0; lane < width; ++lane)
+                p[lane] = floatToHalf(lanes[lane]);
+        }
+        static Reg loadBF16(const std::uint16_t* p)
+        {
+            __m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+            return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), bits));
+        }
+        static void storeBF16(std::uint16_t* p, Reg v)
+        {
+            // Round to nearest even on the integer bits; NaN is truncated and kept quiet.
+            __m128i bits = _mm_castps_si128(v);
+            __m128i odd = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(1));
+            __m128i rounded = _mm_add_epi32(bits, _mm_add_epi32(_mm_set1_epi32(0x7FFF), odd));
+            __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(v, v));
+            __m128i quiet = _mm_or_si128(bits, _mm_set1_epi32(0x400000));
+            rounded = _mm_or_si128(_mm_and_si128(nan, quiet), _mm_andnot_si128(nan, rounded));
+            // The arithmetic shift keeps the top halves in int16 range for the saturating pack.
+            __m128i top = _mm_srai_epi32(rounded, 16);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(top, top));
+        }
+    };
+
+    struct Sse2Int8
+    {
+        using Reg = __m128i;
+        static constexpr std::size_t width = 16;
+
+        static Reg zero() { return _mm_setzero_si128(); }
+        // Widens both operands to 16 bits (zero and sign extension by unpacking) and lets
+        // pmaddwd multiply and add pairs into 32-bit lanes.
+        static Reg dotAdd(Reg sum, const std::uint8_t* a, const std::int8_t* b)
+        {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+            __m128i aLow = _mm_unpacklo_epi8(va, _mm_setzero_si128()), aHigh = _mm_unpackhi_epi8(va, _mm_setzero_si128());
+            __m128i bLow = _mm_srai_epi16(_mm_unpacklo_epi8(vb, vb), 8), bHigh = _mm_srai_epi16(_mm_unpackhi_epi8(vb, vb), 8);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(aLow, bLow));
+            return _mm_add_epi32(sum, _mm_madd_epi16(aHigh, bHigh));
+        }
+        static std::int32_t reduceAdd(Reg sum)
+        {
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+            return _mm_cvtsi128_si32(sum);
+        }
+    };
+
+    struct Sse2
+    {
+        using Float = Sse2Float;
+        using Int8 = Sse2Int8;
+        using Reg = __m128d;
+        static constexpr std::size_t width = 2;
+
+        static Reg load(const double* p) { return _mm_loadu_pd(p); }
+        static void store(double* p, Reg v) { _mm_storeu_pd(p, v); }
+        static Reg set1(double v) { return _mm_set1_pd(v); }
+        static Reg add(Reg a, Reg b) { return _mm_add_pd(a, b); }
+        static Reg sub(Reg a, Reg b) { return _mm_sub_pd(a, b); }
+        static Reg mul(Reg a, Reg b) { return _mm_mul_pd(a, b); }
+        static Reg div(Reg a, Reg b) { return _mm_div_pd(a, b); }
+        static Reg sqrt(Reg a) { return _mm_sqrt_pd(a); }
+        static Reg min(Reg a, Reg b) { return _mm_min_pd(a, b); }
+        static Reg max(Reg a, Reg b) { return _mm_max_pd(a, b); }
+        static Reg fmadd(Reg a, Reg b, Reg c) { return _mm_add_pd(_mm_mul_pd(a, b), c); } // SSE2 has no FMA
+        // Float estimate. a = m 4^k with m in [2^-52, 4) keeps the estimate in float range for
+        // every a >= 0: 1 / sqrt(a) = rsqrt(m) 2^-k, with both powers built in the exponent bits.
+        static Reg rsqrt(Reg a)
+        {
+            __m128i exponent = _mm_srli_epi64(_mm_castpd_si128(a), 52); // a >= 0, so no sign bit
+            exponent = _mm_max_epi16(exponent, _mm_set1_epi64x(1));     // subnormals scale like 2^-1022
+            exponent = _mm_min_epi16(exponent, _mm_set1_epi64x(2046));
+            __m128i k = _mm_srli_epi64(_mm_add_epi64(exponent, _mm_set1_epi64x(1)), 1); // k + 512
+            __m128d down = _mm_castsi128_pd(_mm_slli_epi64(_mm_sub_epi64(_mm_set1_epi64x(2047), _mm_add_epi64(k, k)), 52)); // 4^-k
+            __m128d up = _mm_castsi128_pd(_mm_slli_epi64(_mm_sub_epi64(_mm_set1_epi64x(1535), k), 52));                    // 2^-k
+            return _mm_mul_pd(_mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(_mm_mul_pd(a, down)))), up);
+        }
+        static Reg zeroUnlessPositive(Reg condition, Reg v) { return _mm_and_pd(_mm_cmpgt_pd(condition, _mm_setzero_pd()), v); }
+        static Reg selectPositive(Reg condition, Reg a, Reg b)
+        {
+            Reg mask = _mm_cmpgt_pd(condition, _mm_setzero_pd());
+            return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+        }
+        static Reg signOf(Reg a) { return _mm_or_pd(_mm_and_pd(a, _mm_set1_pd(-0.0)), _mm_set1_pd(1.0)); }
+    };
+
+#include "vector_simd_kernels.inl"
+}
+
+const BatchKernels* sse2BatchKernels()
+{
+    return SimdKernels<Sse2>::table(SimdLevel::SSE2);
+}
+
+#else
+
+const BatchKernels* sse2BatchKernels()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include <cstddef>
+#include <cstdint>
+
+#include "vector_simd.hpp"
+
+// Byte dot products with the VNNI instruction vpdpbusd, which multiplies unsigned by signed
+// bytes and adds groups of four into 32-bit lanes in one instruction. GCC enables each
+// instruction set for its own function below; Clang needs -mavx512vnni and -mavxvnni, and
+// Visual Studio accepts the intrinsics without flags. vector_simd.cpp only installs these
+// after checking CPUID.
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__)) && __GNUC__ >= 11
+#include <immintrin.h>
+// GCC 12 warns about the deliberately undefined registers inside its own intrinsics.
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#define SIMD_HAVE_AVX512_VNNI 1
+#define SIMD_HAVE_AVX_VNNI 1
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#define SIMD_HAVE_AVX512_VNNI 1
+#define SIMD_HAVE_AVX_VNNI 1
+#else
+#if defined(__AVX512VNNI__)
+#include <immintrin.h>
+#define SIMD_HAVE_AVX512_VNNI 1
+#endif
+#if defined(__AVXVNNI__)
+#include <immintrin.h>
+#define SIMD_HAVE_AVX_VNNI 1
+#endif
+#endif
+
+namespace
+{
+#ifdef SIMD_HAVE_AVX512_VNNI
+#if defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512vnni")
+#endif
+    std::int32_t dotProductAvx512Vnni(const std::uint8_t* a, const std::int8_t* b, std::size_t n)
+    {
+        __m512i sum0 = _mm512_setzero_si512(), sum1 = _mm512_setzero_si512();
+        std::size_t i = 0;
+        for (; i + 128 <= n; i += 128)
+        {
+            sum0 = _mm512_dpbusd_epi32(sum0, _mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+            sum1 = _mm512_dpbusd_epi32(sum1, _mm512_loadu_si512(a + i + 64), _mm512_loadu_si512(b + i + 64));
+        }
+        for (; i + 64 <= n; i += 64)
+            sum0 = _mm512_dpbusd_epi32(sum0, _mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        std::int32_t result = _mm512_reduce_add_epi32(_mm512_add_epi32(sum0, sum1));
+        for (; i < n; ++i)
+            result += a[i] * b[i];
+        return result;
+    }
+#if defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif
+
+#ifdef SIMD_HAVE_AVX_VNNI
+#if defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,avxvnni")
+#endif
+    std::int32_t dotProductAvxVnni(const std::uint8_t* a, const std::int8_t* b, std::size_t n)
+    {
+        __m256i sum0 = _mm256_setzero_si256(), sum1 = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 64 <= n; i += 64)
+        {
+            sum0 = _mm256_dpbusd_avx_epi32(sum0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                           _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+            sum1 = _mm256_dpbusd_avx_epi32(sum1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 32)),
+                                           _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 32)));
+        }
+        for (; i + 32 <= n; i += 32)
+        {
+            sum0 = _mm256_dpbusd_avx_epi32(sum0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                           _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        }
+        __m256i sum = _mm256_add_epi32(sum0, sum1);
+        __m128i quad = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        quad = _mm_add_epi32(quad, _mm_shuffle_epi32(quad, 0x4E));
+        quad = _mm_add_epi32(quad, _mm_shuffle_epi32(quad, 0xB1));
+        std::int32_t result = _mm_cvtsi128_si32(quad);
+        for (; i < n; ++i)
+            result += a[i] * b[i];
+        return result;
+    }
+#if defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif
+}
+
+DotProductU8I8 avx512VnniDotProductU8I8()
+{
+#ifdef SIMD_HAVE_AVX512_VNNI
+    return &dotProductAvx512Vnni;
+#else
+    return nullptr;
+#endif
+}
+
+DotProductU8I8 avxVnniDotProductU8I8()
+{
+#ifdef SIMD_HAVE_AVX_VNNI
+    return &dotProductAvxVnni;
+#else
+    return nullptr;
+#endif
+}
@@ -0,0 +1,1065 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "batch_reduce.hpp"
+#include "bounding_box.hpp"
+#include "bvh.hpp"
+#include "cosine_search.hpp"
+#include "hnsw.hpp"
+#include "kdtree.hpp"
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "point_cloud.hpp"
+#include "quantized_search.hpp"
+#include "spatial_grid.hpp"
+#include "vector_batch.hpp"
+#include "vector_simd.hpp"
+
+// Checks of the library's documented guarantees. Run with no arguments for every section, or
+// name the sections to run; the exit code is the number of failed checks, at most 255.
+
+namespace
+{
+    int failures = 0;
+
+    // Records a failed condition with its location and keeps going, so one run reports
+    // everything that is broken.
+#define CHECK(condition)                                                                 \
+    do                                                                                   \
+    {                                                                                    \
+        if (!(condition))                                                                \
+        {                                                                                \
+            std::printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition);         \
+            ++failures;                                                                  \
+        }                                                                                \
+    } while (false)
+
+    bool sameBits(double a, double b)
+    {
+        return std::memcmp(&a, &b, sizeof(double)) == 0;
+    }
+
+    // ---- sum: ReductionMode::Deterministic ----
+
+    // Values spread over many magnitudes with both signs, so that any change in the order of
+    // the additions shows up in the low bits.
+    Vector3DBatch cancellingBatch(std::size_t count)
+    {
+        std::mt19937_64 random(18);
+        std::uniform_real_distribution<double> mantissa(-1.0, 1.0);
+        std::uniform_int_distribution<int> exponent(-20, 20);
+        Vector3DBatch batch(count);
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                batch.component(axis)[i] = std::ldexp(mantissa(random), exponent(random));
+        }
+        return batch;
+    }
+
+    void checkSum()
+    {
+        // Not a multiple of the block size, and enough blocks for every thread count.
+        Vector3DBatch batch = cancellingBatch((37 * 4096) + 123);
+
+        setWorkerThreadCount(1);
+        Vector3D reference = sum(batch, ReductionMode::Deterministic);
+        for (unsigned int threads : { 2u, 3u, 4u, 7u, 16u })
+        {
+            setWorkerThreadCount(threads);
+            for (int repeat = 0; repeat < 3; ++repeat)
+            {
+                Vector3D result = sum(batch, ReductionMode::Deterministic);
+                for (std::size_t axis = 0; axis < 3; ++axis)
+                    CHECK(sameBits(result[axis], reference[axis]));
+            }
+        }
+        setWorkerThreadCount(0);
+
+        // The instruction set half of the guarantee: every compiled level's kernel returns the
+        // scalar table's bits, for lengths around every vector width.
+        const BatchKernels* scalar = batchKernels(SimdLevel::Scalar);
+        CHECK(scalar != nullptr);
+        if (scalar == nullptr)
+            return;
+        for (SimdLevel level : { SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 })
+        {
+            const BatchKernels* kernels = batchKernels(level);
+            if (kernels == nullptr)
+                continue;
+            for (std::size_t count : { 0, 1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 65, 100, 4096, 4099 })
+            {
+                const double* values = batch.component(0);
+                CHECK(sameBits(kernels->sumCompensated(values, count), scalar->sumCompensated(values, count)));
+            }
+        }
+    }
+
+    // ---- hnsw: HnswIndex save and load ----
+
+    bool throwsRuntimeError(HnswIndex& index, const std::string& path)
+    {
+        try
+        {
+            index.load(path);
+        }
+        catch (const std::runtime_error&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    void checkHnsw()
+    {
+        constexpr std::size_t dims = 48;
+        constexpr std::size_t count = 3000;
+        constexpr std::size_t queryCount = 200;
+        constexpr std::size_t k = 10;
+        std::mt19937 random(15);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::vector<float> vectors(count * dims), queries(queryCount * dims);
+        for (float& value : vectors)
+            value = normal(random);
+        for (float& value : queries)
+            value = normal(random);
+
+        HnswParameters parameters;
+        parameters.M = 12;
+        parameters.efConstruction = 100;
+        parameters.efSearch = 40;
+        parameters.seed = 7;
+        HnswIndex original(dims, count, parameters);
+        original.addBatch(vectors.data(), count);
+
+        std::string path = (std::filesystem::temp_directory_path() / "vector_calculator_tests.hnsw").string();
+        original.save(path);
+        HnswIndex loaded;
+        loaded.load(path, count + 100);
+
+        CHECK(loaded.dimension() == dims);
+        CHECK(loaded.size() == count);
+        CHECK(loaded.capacity() >= count + 100);
+        CHECK(loaded.parameters().M == parameters.M);
+        CHECK(loaded.parameters().efConstruction == parameters.efConstruction);
+        CHECK(loaded.parameters().efSearch == parameters.efSearch);
+        CHECK(loaded.parameters().seed == parameters.seed);
+        CHECK(std::memcmp(loaded.vector(0), original.vector(0), count * dims * sizeof(float)) == 0);
+
+        // The same graph walks to the same results, distances included.
+        std::vector<HnswIndex::Result> expected(queryCount * k), actual(queryCount * k);
+        original.searchBatch(queries.data(), queryCount, k, expected.data());
+        loaded.searchBatch(queries.data(), queryCount, k, actual.data());
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < queryCount * k; ++i)
+            mismatches += expected[i].id != actual[i].id || expected[i].distance != actual[i].distance;
+        CHECK(mismatches == 0);
+
+        // A loaded index keeps growing.
+        CHECK(loaded.add(queries.data()) == count);
+
+        // A cut short file and a foreign file are refused.
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+        HnswIndex truncated;
+        CHECK(throwsRuntimeError(truncated, path));
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file << "not an index file at all";
+        }
+        CHECK(throwsRuntimeError(truncated, path));
+        std::filesystem::remove(path);
+        CHECK(throwsRuntimeError(truncated, path));
+    }
+
+    // ---- quantized: QuantizedSearch scores against float cosine similarity ----
+
+    double exactCosine(const float* a, const float* b, std::size_t dims)
+    {
+        double ab = 0.0, aa = 0.0, bb = 0.0;
+        for (std::size_t i = 0; i < dims; ++i)
+        {
+            ab += static_cast<double>(a[i]) * b[i];
+            aa += static_cast<double>(a[i]) * a[i];
+            bb += static_cast<double>(b[i]) * b[i];
+        }
+        return ab / std::sqrt(aa * bb);
+    }
+
+    void checkQuantized()
+    {
+        constexpr std::size_t count = 1000;
+        constexpr std::size_t queryCount = 40;
+        for (std::size_t dims : { std::size_t(7), std::size_t(128), std::size_t(768) })
+        {
+            // Anisotropic data, one dimension in eight twenty times wider, so that the per
+            // vector and per dimension steps differ.
+            std::mt19937 random(24);
+            std::normal_distribution<float> normal(0.0f, 1.0f);
+            std::vector<float> vectors(count * dims), queries(queryCount * dims);
+            for (std::size_t i = 0; i < vectors.size(); ++i)
+                vectors[i] = normal(random) * (i % 8 == 0 ? 20.0f : 1.0f);
+            for (std::size_t i = 0; i < queries.size(); ++i)
+                queries[i] = normal(random) * (i % 8 == 0 ? 20.0f : 1.0f);
+
+            for (QuantizationMode mode : { QuantizationMode::PerVector, QuantizationMode::PerDimension })
+            {
+                QuantizedSearch search(dims, mode);
+                if (mode == QuantizationMode::PerDimension)
+                    search.train(vectors.data(), count);
+                for (std::size_t i = 0; i < count; ++i)
+                    search.add(vectors.data() + (i * dims));
+
+                std::size_t outside = 0;
+                for (std::size_t q = 0; q < queryCount; ++q)
+                {
+                    const float* query = queries.data() + (q * dims);
+                    for (std::size_t id = 0; id < count; ++id)
+                    {
+                        double error = std::abs(search.similarity(query, id) - exactCosine(query, vectors.data() + (id * dims), dims));
+                        double bound = search.similarityErrorBound(query, id);
+                        outside += error > bound + 1e-5;
+                    }
+                }
+                CHECK(outside == 0);
+
+                // Scan scores are the same approximation: without re-ranking search() returns
+                // similarity() for each id it finds.
+                std::vector<QuantizedSearch::Result> results;
+                search.search(queries.data(), 10, results, 0);
+                for (const QuantizedSearch::Result& result : results)
+                    CHECK(result.similarity == search.similarity(queries.data(), result.id));
+            }
+        }
+
+        // Re-ranking against the half precision copies restores the recall of the exact search,
+        // and without copies a rerank request changes nothing.
+        constexpr std::size_t dims = 64;
+        constexpr std::size_t k = 10;
+        std::mt19937 random(25);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::vector<float> vectors(count * 5 * dims), queries(queryCount * dims);
+        for (float& value : vectors)
+            value = normal(random);
+        for (float& value : queries)
+            value = normal(random);
+        CosineSearch exact(dims);
+        for (std::size_t i = 0; i < count * 5; ++i)
+            exact.add(vectors.data() + (i * dims));
+        std::vector<CosineSearch::Result> truth(queryCount * k);
+        exact.searchBatch(queries.data(), queryCount, k, truth.data());
+        auto recall = [&](const std::vector<QuantizedSearch::Result>& found) {
+            std::size_t hits = 0;
+            for (std::size_t q = 0; q < queryCount; ++q)
+            {
+                for (std::size_t i = 0; i < k; ++i)
+                {
+                    for (std::size_t j = 0; j < k; ++j)
+                        hits += found[(q * k) + i].id == truth[(q * k) + j].id;
+                }
+            }
+            return static_cast<double>(hits) / (queryCount * k);
+        };
+
+        QuantizedSearch scanOnly(dims), reranked(dims, QuantizationMode::PerVector, true);
+        CHECK(!scanOnly.keepsVectors() && reranked.keepsVectors());
+        CHECK(scanOnly.bytesPerVector() == dims + 12 && reranked.bytesPerVector() == (3 * dims) + 12);
+        for (std::size_t i = 0; i < count * 5; ++i)
+        {
+            scanOnly.add(vectors.data() + (i * dims));
+            reranked.add(vectors.data() + (i * dims));
+        }
+        std::vector<QuantizedSearch::Result> scanned(queryCount * k), rerankIgnored(queryCount * k), rescored(queryCount * k);
+        scanOnly.searchBatch(queries.data(), queryCount, k, scanned.data(), 0);
+        scanOnly.searchBatch(queries.data(), queryCount, k, rerankIgnored.data(), 4);
+        reranked.searchBatch(queries.data(), queryCount, k, rescored.data(), 4);
+        std::size_t differ = 0;
+        for (std::size_t i = 0; i < scanned.size(); ++i)
+            differ += scanned[i].id != rerankIgnored[i].id || scanned[i].similarity != rerankIgnored[i].similarity;
+        CHECK(differ == 0);
+        CHECK(recall(rescored) >= 0.99);
+        CHECK(recall(rescored) > recall(scanned));
+    }
+
+    // ---- normalize: normalize3 and normalize3Fast over the whole documented range ----
+
+    // Error of a computed component against the exact one, in units in the last place of the
+    // exact value.
+    double ulpError(double computed, long double exact)
+    {
+        double rounded = static_cast<double>(exact);
+        double ulp = std::nextafter(std::abs(rounded), HUGE_VAL) - std::abs(rounded);
+        return static_cast<double>(std::abs(static_cast<long double>(computed) - exact) / ulp);
+    }
+
+    void checkNormalize()
+    {
+        // Directions with components of mixed sizes and signs, scaled to lengths 1e-150 to
+        // 1e150 in steps of 10^3.75, then zero vectors; more than a register of each.
+        std::mt19937_64 random(6);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+        Vector3DBatch batch;
+        for (int step = -40; step <= 40; ++step)
+        {
+            double length = std::pow(10.0, 3.75 * step);
+            for (int i = 0; i < 11; ++i)
+            {
+                Vector3D direction(uniform(random), uniform(random), i == 0 ? 0.0 : uniform(random) * 1e-3);
+                batch.push_back(direction * (length / direction.magnitude()));
+            }
+        }
+        for (int i = 0; i < 11; ++i)
+            batch.push_back(Vector3D(0.0, i % 2 == 0 ? 0.0 : -0.0, 0.0));
+
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 })
+        {
+            const BatchKernels* kernels = batchKernels(level);
+            if (kernels == nullptr)
+                continue;
+            for (bool fast : { false, true })
+            {
+                Vector3DBatch out(batch.size());
+                (fast ? kernels->normalize3Fast : kernels->normalize3)(batch.x(), batch.y(), batch.z(), out.x(), out.y(), out.z(), batch.size());
+                double worst = 0.0;
+                std::size_t nonFinite = 0, nonZero = 0;
+                for (std::size_t i = 0; i < batch.size(); ++i)
+                {
+                    long double lx = batch.x()[i], ly = batch.y()[i], lz = batch.z()[i];
+                    long double length = std::sqrt((lx * lx) + (ly * ly) + (lz * lz));
+                    for (std::size_t axis = 0; axis < 3; ++axis)
+                    {
+                        double r = out.component(axis)[i];
+                        nonFinite += !std::isfinite(r);
+                        if (length == 0.0L)
+                            nonZero += r != 0.0;
+                        else if (batch.component(axis)[i] != 0.0)
+                            worst = std::max(worst, ulpError(r, batch.component(axis)[i] / length));
+                        else
+                            nonZero += r != 0.0;
+                    }
+                }
+                // The ULP bounds of BatchKernels::normalize3Fast and normalize3.
+                double bound = 3.0;
+                if (fast && (level == SimdLevel::SSE2 || level == SimdLevel::AVX2))
+                    bound = std::ldexp(1.0, 31);
+                else if (fast && level == SimdLevel::AVX512)
+                    bound = std::ldexp(1.0, 26);
+                CHECK(worst <= bound);
+                CHECK(nonFinite == 0);
+                CHECK(nonZero == 0);
+            }
+        }
+    }
+
+    // ---- kdtree: KdTree builds on any thread count against brute force ----
+
+    // Rounded like the spatial structures do it, without fused multiply-adds.
+    double distanceSquared(const Vector3D& a, const Vector3D& b)
+    {
+        double dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+        return (dx * dx) + (dy * dy) + (dz * dz);
+    }
+
+    void checkKdTree()
+    {
+        std::mt19937_64 random(12);
+        std::uniform_real_distribution<double> uniform(-100.0, 100.0);
+        Vector3DBatch points, queries;
+        for (std::size_t i = 0; i < 20000; ++i)
+            points.push_back(Vector3D(uniform(random), uniform(random), uniform(random) * 0.01)); // nearly flat
+        for (std::size_t i = 0; i < 10; ++i)
+            points.push_back(points[i]); // duplicates
+        for (std::size_t i = 0; i < 300; ++i)
+            queries.push_back(Vector3D(uniform(random), uniform(random), uniform(random)));
+
+        constexpr std::size_t k = 7;
+        std::vector<double> expected(queries.size() * k);
+        std::vector<double> distances(points.size());
+        for (std::size_t q = 0; q < queries.size(); ++q)
+        {
+            for (std::size_t i = 0; i < points.size(); ++i)
+                distances[i] = distanceSquared(points[i], queries[q]);
+            std::partial_sort(distances.begin(), distances.begin() + k, distances.end());
+            std::copy(distances.begin(), distances.begin() + k, expected.begin() + (q * k));
+        }
+
+        for (unsigned int threads : { 1u, 3u, 8u })
+        {
+            setWorkerThreadCount(threads);
+            for (std::size_t leafSize : { std::size_t(1), std::size_t(16) })
+            {
+                KdTree tree(points, leafSize);
+                CHECK(tree.size() == points.size());
+                std::vector<KdTree::Neighbor> found(queries.size() * k);
+                tree.nearestBatch(queries, k, found.data());
+                std::size_t mismatches = 0;
+                for (std::size_t i = 0; i < found.size(); ++i)
+                    mismatches += found[i].distanceSquared != expected[i] || distanceSquared(points[found[i].index], queries[i / k]) != expected[i];
+                CHECK(mismatches == 0);
+            }
+        }
+        setWorkerThreadCount(0);
+    }
+
+    // ---- cosine: CosineSearch against a double precision scan ----
+
+    void checkCosine()
+    {
+        constexpr std::size_t dims = 37;
+        constexpr std::size_t count = 5000; // not a multiple of the block size
+        constexpr std::size_t queryCount = 150; // two full query groups and a partial one
+        constexpr std::size_t k = 12;
+        std::mt19937 random(16);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::vector<float> vectors(count * dims), queries(queryCount * dims);
+        for (float& value : vectors)
+            value = normal(random);
+        for (float& value : queries)
+            value = normal(random);
+        // Exact ties: copies of vector 10 at higher ids, scaled (normalization removes that),
+        // and query 0 is vector 10 itself.
+        for (std::size_t copy : { std::size_t(700), std::size_t(2000), std::size_t(4999) })
+        {
+            for (std::size_t d = 0; d < dims; ++d)
+                vectors[(copy * dims) + d] = vectors[(10 * dims) + d];
+        }
+        std::copy(vectors.begin() + (10 * dims), vectors.begin() + (11 * dims), queries.begin());
+
+        CosineSearch search(dims);
+        for (std::size_t i = 0; i < count; ++i)
+            CHECK(search.add(vectors.data() + (i * dims)) == i);
+
+        // The reference ranks every vector by its double cosine, ties to the lower id.
+        std::vector<std::pair<double, std::size_t>> ranked(count);
+        std::vector<std::vector<std::pair<double, std::size_t>>> expected(queryCount);
+        for (std::size_t q = 0; q < queryCount; ++q)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                ranked[i] = { -exactCosine(queries.data() + (q * dims), vectors.data() + (i * dims), dims), i };
+            std::partial_sort(ranked.begin(), ranked.begin() + k + 1, ranked.end());
+            expected[q].assign(ranked.begin(), ranked.begin() + k + 1);
+        }
+
+        for (unsigned int threads : { 1u, 3u, 8u })
+        {
+            setWorkerThreadCount(threads);
+            std::vector<CosineSearch::Result> results(queryCount * k);
+            search.searchBatch(queries.data(), queryCount, k, results.data());
+            std::size_t wrongScores = 0, wrongIds = 0, misordered = 0;
+            for (std::size_t q = 0; q < queryCount; ++q)
+            {
+                for (std::size_t r = 0; r < k; ++r)
+                {
+                    const CosineSearch::Result& result = results[(q * k) + r];
+                    // Float scores: the value at each rank matches, and the id is the
+                    // reference's unless a neighboring rank is closer than the float rounding.
+                    const std::vector<std::pair<double, std::size_t>>& reference = expected[q];
+                    bool nearTie = std::abs(reference[r].first - reference[r + 1].first) <= 1e-5 ||
+                                   (r > 0 && std::abs(reference[r].first - reference[r - 1].first) <= 1e-5);
+                    wrongScores += std::abs(result.similarity + reference[r].first) > 1e-5;
+                    wrongIds += result.id != reference[r].second && !nearTie;
+                    if (r > 0)
+                    {
+                        const CosineSearch::Result& previous = results[(q * k) + r - 1];
+                        misordered += previous.similarity < result.similarity || (previous.similarity == result.similarity && previous.id > result.id);
+                    }
+                }
+            }
+            CHECK(wrongScores == 0);
+            CHECK(wrongIds == 0);
+            CHECK(misordered == 0);
+
+            // The exact copies score the same and come out by id.
+            CHECK(results[0].id == 10 && results[1].id == 700 && results[2].id == 2000 && results[3].id == 4999);
+            CHECK(results[0].similarity == results[3].similarity);
+
+            // search() agrees with searchBatch() for the last, partial group's query.
+            std::vector<CosineSearch::Result> single;
+            search.search(queries.data() + ((queryCount - 1) * dims), k, single);
+            CHECK(single.size() == k);
+            for (std::size_t r = 0; r < single.size(); ++r)
+                CHECK(single[r].id == results[((queryCount - 1) * k) + r].id);
+        }
+        setWorkerThreadCount(0);
+
+        // More results asked for than stored: the rest is padding, and search() trims it.
+        CosineSearch small(dims);
+        for (std::size_t i = 0; i < 5; ++i)
+            small.add(vectors.data() + (i * dims));
+        std::vector<CosineSearch::Result> padded(2 * 8);
+        small.searchBatch(queries.data(), 2, 8, padded.data());
+        for (std::size_t q = 0; q < 2; ++q)
+        {
+            for (std::size_t r = 0; r < 8; ++r)
+            {
+                const CosineSearch::Result& result = padded[(q * 8) + r];
+                if (r < 5)
+                    CHECK(result.id < 5);
+                else
+                    CHECK(result.id == CosineSearch::npos && result.similarity == -std::numeric_limits<float>::infinity());
+            }
+        }
+        std::vector<CosineSearch::Result> trimmed;
+        small.search(queries.data(), 8, trimmed);
+        CHECK(trimmed.size() == 5);
+    }
+
+    // ---- bvh: Bvh queries against brute force, before and after refit ----
+
+    Vector3D closestOnSegment(const Vector3D& query, const Vector3D& a, const Vector3D& b)
+    {
+        Vector3D ab = b - a;
+        double lengthSquared = ab.magnitudeSquared();
+        if (lengthSquared == 0.0)
+            return a;
+        double t = std::clamp((query - a).dotProduct(ab) / lengthSquared, 0.0, 1.0);
+        return a + (ab * t);
+    }
+
+    // First hit of the ray origin + t d (d unit length) with the capsule around pa-pb, or -1:
+    // the nearest of the hits with the cylinder side and the two end spheres, solved directly.
+    double capsuleHit(const Vector3D& origin, const Vector3D& d, const Vector3D& pa, const Vector3D& pb, double radius)
+    {
+        double best = -1.0;
+        auto offer = [&](double t) {
+            if (t >= 0.0 && (best < 0.0 || t < best))
+                best = t;
+        };
+        for (const Vector3D& center : { pa, pb })
+        {
+            Vector3D oc = origin - center;
+            double b = d.dotProduct(oc), c = oc.magnitudeSquared() - (radius * radius);
+            if ((b * b) - c >= 0.0 && c > 0.0)
+                offer(-b - std::sqrt((b * b) - c));
+        }
+        Vector3D axis = pb - pa;
+        double length = axis.magnitude();
+        if (length == 0.0)
+            return best;
+        axis = axis * (1.0 / length);
+        Vector3D oa = origin - pa;
+        Vector3D dPerp = d - (axis * d.dotProduct(axis)), oPerp = oa - (axis * oa.dotProduct(axis));
+        double a = dPerp.magnitudeSquared(), b = dPerp.dotProduct(oPerp), c = oPerp.magnitudeSquared() - (radius * radius);
+        if (a > 1e-12 && (b * b) - (a * c) >= 0.0 && c > 0.0)
+        {
+            double t = (-b - std::sqrt((b * b) - (a * c))) / a;
+            double along = (oa + (d * t)).dotProduct(axis);
+            if (along >= 0.0 && along <= length)
+                offer(t);
+        }
+        return best;
+    }
+
+    struct BvhScene
+    {
+        Vector3DBatch points, starts, ends;
+        double radius = 0.0;
+
+        Vector3D start(std::size_t id) const { return id < points.size() ? points[id] : starts[id - points.size()]; }
+        Vector3D end(std::size_t id) const { return id < points.size() ? points[id] : ends[id - points.size()]; }
+        std::size_t size() const { return points.size() + starts.size(); }
+    };
+
+    // Runs every query type against brute force over the scene and returns the mismatches.
+    std::size_t bvhMismatches(const Bvh& bvh, const BvhScene& scene, std::mt19937_64& random)
+    {
+        std::uniform_real_distribution<double> uniform(-12.0, 12.0);
+        std::size_t mismatches = 0;
+        for (int q = 0; q < 300; ++q)
+        {
+            Vector3D query(uniform(random), uniform(random), uniform(random));
+
+            Bvh::ClosestHit closest{};
+            double bestSquared = std::numeric_limits<double>::infinity();
+            for (std::size_t id = 0; id < scene.size(); ++id)
+                bestSquared = std::min(bestSquared, query.distanceSquared(closestOnSegment(query, scene.start(id), scene.end(id))));
+            mismatches += !bvh.closestPoint(query, closest) || closest.distanceSquared != bestSquared ||
+                          query.distanceSquared(closestOnSegment(query, scene.start(closest.primitive), scene.end(closest.primitive))) != bestSquared;
+
+            Vector3D size(std::abs(uniform(random)) * 0.3, std::abs(uniform(random)) * 0.3, std::abs(uniform(random)) * 0.3);
+            Box3D box(query - size, query + size);
+            std::vector<std::size_t> found, expected;
+            bvh.queryBox(box, found);
+            for (std::size_t id = 0; id < scene.size(); ++id)
+            {
+                Box3D bounds;
+                bounds.grow(scene.start(id));
+                bounds.grow(scene.end(id));
+                bounds.inflate(scene.radius);
+                if (bounds.overlaps(box))
+                    expected.push_back(id);
+            }
+            std::sort(found.begin(), found.end());
+            mismatches += found != expected;
+
+            Vector3D direction(uniform(random), uniform(random), uniform(random));
+            Vector3D d = direction * (1.0 / direction.magnitude());
+            double maxT = 2.0;
+            double bestT = -1.0;
+            for (std::size_t id = 0; id < scene.size(); ++id)
+            {
+                double t = capsuleHit(query, d, scene.start(id), scene.end(id), scene.radius);
+                if (t >= 0.0 && t <= maxT * direction.magnitude() && (bestT < 0.0 || t < bestT))
+                    bestT = t;
+            }
+            Bvh::RayHit hit{};
+            bool didHit = bvh.intersectRay(query, direction, maxT, hit);
+            if (didHit != (bestT >= 0.0))
+                mismatches += std::abs(bestT - (maxT * direction.magnitude())) > 1e-9; // a grazing hit at the end of the range
+            else if (didHit)
+                mismatches += std::abs((hit.t * direction.magnitude()) - bestT) > 1e-9;
+        }
+        return mismatches;
+    }
+
+    void checkBvh()
+    {
+        std::mt19937_64 random(13);
+        std::uniform_real_distribution<double> uniform(-10.0, 10.0), offset(-0.5, 0.5), drift(-3.0, 3.0);
+        BvhScene scene;
+        scene.radius = 0.05;
+        for (int i = 0; i < 2000; ++i)
+            scene.points.push_back(Vector3D(uniform(random), uniform(random), uniform(random)));
+        for (int i = 0; i < 1000; ++i)
+        {
+            Vector3D start(uniform(random), uniform(random), uniform(random));
+            scene.starts.push_back(start);
+            scene.ends.push_back(start + Vector3D(offset(random), offset(random), offset(random)));
+        }
+
+        Bvh bvh;
+        bvh.build(scene.points, scene.starts, scene.ends, scene.radius);
+        CHECK(bvh.pointCount() == 2000 && bvh.primitiveCount() == 3000);
+        CHECK(bvhMismatches(bvh, scene, random) == 0);
+
+        // Move everything, some primitives far across the tree, and refit the same topology.
+        for (int step = 0; step < 3; ++step)
+        {
+            for (std::size_t i = 0; i < scene.points.size(); ++i)
+                scene.points.set(i, scene.points[i] + Vector3D(drift(random), drift(random), drift(random)));
+            for (std::size_t i = 0; i < scene.starts.size(); ++i)
+            {
+                Vector3D move(drift(random), drift(random), drift(random));
+                scene.starts.set(i, scene.starts[i] + move);
+                scene.ends.set(i, scene.ends[i] + move + Vector3D(offset(random), offset(random), offset(random)));
+            }
+            bvh.refit(scene.points, scene.starts, scene.ends);
+            CHECK(bvhMismatches(bvh, scene, random) == 0);
+        }
+
+        // Empty hierarchies answer nothing.
+        Bvh empty;
+        empty.build(Vector3DBatch(), Vector3DBatch(), Vector3DBatch());
+        Bvh::ClosestHit closest{};
+        Bvh::RayHit hit{};
+        std::vector<std::size_t> found;
+        empty.queryBox(Box3D(Vector3D(-1.0, -1.0, -1.0), Vector3D(1.0, 1.0, 1.0)), found);
+        CHECK(!empty.closestPoint(Vector3D(), closest) && !empty.intersectRay(Vector3D(), Vector3D(1.0, 0.0, 0.0), 10.0, hit) && found.empty());
+    }
+
+    // ---- grid: SpatialGrid pairs and radius queries against brute force, 2D and 3D ----
+
+    template <std::size_t N>
+    double gridDistanceSquared(const VectorN<double, N>& a, const VectorN<double, N>& b)
+    {
+        double result = 0.0;
+        for (std::size_t axis = 0; axis < N; ++axis)
+            result += (a[axis] - b[axis]) * (a[axis] - b[axis]);
+        return result;
+    }
+
+    // Random points around the origin, cell corners (so distances of exactly one cell occur)
+    // and duplicates; cells are 0.75 wide, so many coordinates are negative.
+    template <std::size_t N>
+    void checkGridIn()
+    {
+        constexpr double cellSize = 0.75;
+        std::mt19937_64 random(14 + N);
+        std::uniform_real_distribution<double> uniform(-6.0, 6.0);
+        std::uniform_int_distribution<int> corner(-4, 4);
+        VectorBatch<double, N> points;
+        for (int i = 0; i < 2500; ++i)
+        {
+            VectorN<double, N> p;
+            for (std::size_t axis = 0; axis < N; ++axis)
+                p[axis] = i % 5 == 0 ? corner(random) * cellSize : uniform(random);
+            points.push_back(p);
+        }
+        for (std::size_t i = 0; i < 20; ++i)
+            points.push_back(points[i]);
+        std::vector<VectorN<double, N>> queries;
+        for (std::size_t i = 0; i < 200; ++i)
+        {
+            VectorN<double, N> query = points[i]; // points themselves for i % 4 == 0
+            for (std::size_t axis = 0; axis < N && i % 4 != 0; ++axis)
+                query[axis] += 0.1 * (static_cast<double>((i + axis) % 7) - 3.0);
+            queries.push_back(query);
+        }
+
+        for (unsigned int threads : { 1u, 4u })
+        {
+            setWorkerThreadCount(threads);
+            SpatialGrid<double, N> grid;
+            grid.build(points, cellSize);
+            CHECK(grid.size() == points.size());
+
+            for (double radius : { cellSize, 0.4 * cellSize })
+            {
+                std::vector<std::pair<std::size_t, std::size_t>> found, expected;
+                grid.forEachPairWithinRadius(radius, [&](std::size_t i, std::size_t j) { found.push_back(std::minmax(i, j)); });
+                for (std::size_t i = 0; i < points.size(); ++i)
+                {
+                    for (std::size_t j = i + 1; j < points.size(); ++j)
+                    {
+                        if (gridDistanceSquared<N>(points[i], points[j]) <= radius * radius)
+                            expected.push_back({ i, j });
+                    }
+                }
+                std::sort(found.begin(), found.end());
+                CHECK(found == expected); // so no pair twice, and none missing
+            }
+
+            // Radii past the cell size reach ceil(radius / cellSize) cells out.
+            std::size_t mismatches = 0;
+            for (double radius : { 0.3, cellSize, 2.5 * cellSize, 4.1 * cellSize })
+            {
+                for (const VectorN<double, N>& query : queries)
+                {
+                    std::vector<std::size_t> found, expected;
+                    grid.withinRadius(query, radius, found);
+                    for (std::size_t i = 0; i < points.size(); ++i)
+                    {
+                        if (gridDistanceSquared<N>(points[i], query) <= radius * radius)
+                            expected.push_back(i);
+                    }
+                    std::sort(found.begin(), found.end());
+                    mismatches += found != expected;
+                }
+            }
+            CHECK(mismatches == 0);
+        }
+        setWorkerThreadCount(0);
+    }
+
+    void checkGrid()
+    {
+        checkGridIn<2>();
+        checkGridIn<3>();
+    }
+
+    // ---- frames: orthonormalBasis3 and orthonormalFrame3 at every level against Scalar and Matrix3 ----
+
+    void checkFrames()
+    {
+        // Random normals of mixed lengths, the axes both ways (z = +-0 and +-1 are where the
+        // basis switches sign), and a zero normal. Each gets a random tangent, then a zero,
+        // a parallel, an antiparallel and a nearly parallel one, which must all fall back
+        // to the basis.
+        std::mt19937_64 random(21);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+        std::vector<Vector3D> normals;
+        for (int i = 0; i < 40; ++i)
+            normals.push_back(Vector3D(uniform(random), uniform(random), uniform(random)) * std::pow(10.0, uniform(random) * 5.0));
+        for (double sign : { 1.0, -1.0 })
+        {
+            normals.push_back(Vector3D(sign, 0.0, 0.0));
+            normals.push_back(Vector3D(0.0, sign, 0.0));
+            normals.push_back(Vector3D(0.0, 0.0, sign));
+            normals.push_back(Vector3D(0.3, -0.4, sign * 0.0));
+        }
+        normals.push_back(Vector3D());
+
+        Vector3DBatch normalBatch, tangentBatch;
+        std::vector<bool> fallsBack;
+        for (const Vector3D& normal : normals)
+        {
+            Vector3D tangent(uniform(random), uniform(random), uniform(random));
+            Vector3D across = normal.crossProduct(tangent).normalize();
+            bool zeroNormal = normal.magnitudeSquared() == 0.0;
+            for (Vector3D t : { tangent, Vector3D(), normal * 3.0, normal * -0.5, normal + (across * (1e-9 * normal.magnitude())) })
+            {
+                normalBatch.push_back(normal);
+                tangentBatch.push_back(t);
+                fallsBack.push_back(zeroNormal || t.magnitudeSquared() == 0.0 || t.crossProduct(normal).magnitudeSquared() < 1e-14 * t.magnitudeSquared() * normal.magnitudeSquared());
+            }
+        }
+        std::size_t n = normalBatch.size();
+
+        std::vector<double> scalarStorage;
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 })
+        {
+            const BatchKernels* kernels = batchKernels(level);
+            if (kernels == nullptr)
+                continue;
+            std::vector<double> basisStorage(9 * n), frameStorage(9 * n);
+            double* basis[9];
+            double* frame[9];
+            for (std::size_t e = 0; e < 9; ++e)
+            {
+                basis[e] = basisStorage.data() + (e * n);
+                frame[e] = frameStorage.data() + (e * n);
+            }
+            kernels->orthonormalBasis3(normalBatch.x(), normalBatch.y(), normalBatch.z(), basis, n);
+            kernels->orthonormalFrame3(normalBatch.x(), normalBatch.y(), normalBatch.z(), tangentBatch.x(), tangentBatch.y(), tangentBatch.z(), frame, n);
+
+            // Every level against the Scalar table first, then all of them against Matrix3.
+            if (level == SimdLevel::Scalar)
+            {
+                scalarStorage = basisStorage;
+                scalarStorage.insert(scalarStorage.end(), frameStorage.begin(), frameStorage.end());
+            }
+            double worstScalar = 0.0;
+            for (std::size_t e = 0; e < 9 * n; ++e)
+                worstScalar = std::max({ worstScalar, std::abs(basisStorage[e] - scalarStorage[e]), std::abs(frameStorage[e] - scalarStorage[(9 * n) + e]) });
+            CHECK(worstScalar <= 1e-12);
+
+            double worstReference = 0.0, worstOrthonormal = 0.0, worstFallback = 0.0;
+            std::size_t wrongTangents = 0;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                Vector3D normal = normalBatch[i], tangent = tangentBatch[i];
+                for (int withTangent = 0; withTangent < 2; ++withTangent)
+                {
+                    double* const* m = withTangent ? frame : basis;
+                    Matrix3<double> expected = withTangent ? Matrix3<double>::orthonormalFrame(normal, tangent) : Matrix3<double>::orthonormalBasis(normal);
+                    Matrix3<double> found;
+                    for (std::size_t e = 0; e < 9; ++e)
+                    {
+                        found(e / 3, e % 3) = m[e][i];
+                        worstReference = std::max(worstReference, std::abs(found(e / 3, e % 3) - expected(e / 3, e % 3)));
+                        if (withTangent && fallsBack[i])
+                            worstFallback = std::max(worstFallback, std::abs(frame[e][i] - basis[e][i]));
+                    }
+                    if (normal.magnitudeSquared() == 0.0)
+                        continue; // tangent and bitangent are still the x and y axes, with a zero normal
+                    Matrix3<double> gram = found.transpose() * found;
+                    for (std::size_t e = 0; e < 9; ++e)
+                        worstOrthonormal = std::max(worstOrthonormal, std::abs(gram(e / 3, e % 3) - (e % 4 == 0 ? 1.0 : 0.0)));
+                    worstOrthonormal = std::max(worstOrthonormal, std::abs(found.determinant() - 1.0));
+                    // A kept tangent stays in its plane with the normal, on the same side.
+                    if (withTangent && !fallsBack[i])
+                        wrongTangents += !(found.column(0).dotProduct(tangent) > 0.0) || std::abs(found.column(1).dotProduct(tangent)) > 1e-12 * tangent.magnitude();
+                }
+            }
+            CHECK(worstReference <= 1e-12);
+            CHECK(worstOrthonormal <= 1e-14);
+            CHECK(worstFallback <= 1e-15);
+            CHECK(wrongTangents == 0);
+        }
+    }
+
+    // ---- covariance: symmetricEigen and CovarianceAccumulator against exact answers ----
+
+    // Largest entry of |a - b|.
+    double maxDifference(const Matrix3<double>& a, const Matrix3<double>& b)
+    {
+        double result = 0.0;
+        for (std::size_t e = 0; e < 9; ++e)
+            result = std::max(result, std::abs(a(e / 3, e % 3) - b(e / 3, e % 3)));
+        return result;
+    }
+
+    // Checks that eigen holds the given eigenvalues, largest first, with orthonormal right-handed
+    // vectors v satisfying A v = lambda v, all relative to the largest eigenvalue.
+    void checkEigen(const Matrix3<double>& matrix, const SymmetricEigen3<double>& eigen, const Vector3D& values)
+    {
+        double scale = std::max(std::abs(values[0]), 1e-300);
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            CHECK(std::abs(eigen.values[i] - values[i]) <= 1e-13 * scale);
+            Vector3D v = eigen.vectors.column(i);
+            CHECK((matrix * v - v * eigen.values[i]).magnitude() <= 1e-13 * scale);
+        }
+        CHECK(maxDifference(eigen.vectors.transpose() * eigen.vectors, Matrix3<double>::identity()) <= 1e-14);
+        CHECK(std::abs(eigen.vectors.determinant() - 1.0) <= 1e-14);
+    }
+
+    // Co-moments of the points about their mean in long double, two passes.
+    Matrix3<double> exactCovariance(const Vector3DBatch& points)
+    {
+        long double mean[3] = {};
+        for (std::size_t i = 0; i < points.size(); ++i)
+        {
+            for (std::size_t axis = 0; axis < 3; ++axis)
+                mean[axis] += points.component(axis)[i];
+        }
+        for (long double& m : mean)
+            m /= points.size();
+        long double sums[3][3] = {};
+        for (std::size_t i = 0; i < points.size(); ++i)
+        {
+            for (std::size_t r = 0; r < 3; ++r)
+            {
+                for (std::size_t c = 0; c < 3; ++c)
+                    sums[r][c] += (points.component(r)[i] - mean[r]) * (points.component(c)[i] - mean[c]);
+            }
+        }
+        Matrix3<double> result;
+        for (std::size_t e = 0; e < 9; ++e)
+            result(e / 3, e % 3) = static_cast<double>(sums[e / 3][e % 3] / points.size());
+        return result;
+    }
+
+    void checkCovariance()
+    {
+        // Eigenpairs of R diag R^T for a rotation R: distinct, repeated and zero eigenvalues.
+        Matrix3<double> rotation = Matrix3<double>::rotation(Vector3D(0.3, -1.0, 0.6), 37.0);
+        for (Vector3D values : { Vector3D(9.0, 4.0, 0.25), Vector3D(2.0, 2.0, 1.0), Vector3D(3.0, 0.0, 0.0), Vector3D(1e-8, 1e-9, -1e-10), Vector3D() })
+        {
+            Matrix3<double> diagonal = Matrix3<double>::scale(values);
+            Matrix3<double> matrix = rotation * diagonal * rotation.transpose();
+            SymmetricEigen3<double> eigen = symmetricEigen(matrix);
+            checkEigen(matrix, eigen, values);
+            // Distinct eigenvalues pin the eigenvectors down to sign.
+            if (values[0] != values[1] && values[1] != values[2])
+            {
+                for (std::size_t i = 0; i < 3; ++i)
+                    CHECK(std::abs(std::abs(eigen.vectors.column(i).dotProduct(rotation.column(i))) - 1.0) <= 1e-13);
+            }
+        }
+
+        // A lattice {-20..20}^3 scaled by (6, 2, 0.5) per axis, rotated and moved far from the
+        // origin: its covariance is exactly R diag(s^2 k (k + 1) / 3) R^T with k = 20. 68921
+        // points, so several reduction chunks.
+        constexpr int k = 20;
+        const Vector3D spread(6.0, 2.0, 0.5), center(1e6, -3e5, 2e5);
+        Vector3DBatch cloud;
+        for (int i = -k; i <= k; ++i)
+        {
+            for (int j = -k; j <= k; ++j)
+            {
+                for (int l = -k; l <= k; ++l)
+                    cloud.push_back(center + (rotation * Vector3D(i * spread.x, j * spread.y, l * spread.z)));
+            }
+        }
+        Vector3D variances;
+        for (std::size_t axis = 0; axis < 3; ++axis)
+            variances[axis] = spread[axis] * spread[axis] * (k * (k + 1)) / 3.0;
+        Matrix3<double> expected = rotation * Matrix3<double>::scale(variances) * rotation.transpose();
+        Matrix3<double> exact = exactCovariance(cloud);
+        CHECK(maxDifference(exact, expected) <= 1e-12 * variances[0]);
+
+        for (unsigned int threads : { 1u, 4u })
+        {
+            setWorkerThreadCount(threads);
+            CovarianceAccumulatorD single = covariance(cloud);
+            CHECK(single.count == cloud.size());
+            CHECK((single.mean - center).magnitude() <= 1e-14 * center.magnitude());
+            CHECK(maxDifference(single.matrix(), exact) <= 1e-12 * variances[0]);
+            PrincipalAxes<double> axes = principalAxes(single);
+            for (std::size_t i = 0; i < 3; ++i)
+            {
+                CHECK(std::abs(axes.variances[i] - variances[i]) <= 1e-9 * variances[0]);
+                CHECK(std::abs(std::abs(axes.axes.column(i).dotProduct(rotation.column(i))) - 1.0) <= 1e-12);
+            }
+        }
+        setWorkerThreadCount(0);
+
+        // Uneven pieces, each through a different route, merged into one: Welford's add, the
+        // batch covariance, and fromMoments of plain sums about the piece's first point. They
+        // must agree with a single pass over everything, in either merge order.
+        const std::size_t cuts[] = { 0, 1, 8, 1009, 20000, 45000, cloud.size() };
+        std::vector<CovarianceAccumulatorD> pieces;
+        for (std::size_t c = 0; c + 1 < std::size(cuts); ++c)
+        {
+            std::size_t begin = cuts[c], end = cuts[c + 1];
+            CovarianceAccumulatorD piece;
+            if (c % 3 == 0)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                    piece.add(cloud[i]);
+            }
+            else if (c % 3 == 1)
+            {
+                Vector3DBatch part;
+                for (std::size_t i = begin; i < end; ++i)
+                    part.push_back(cloud[i]);
+                piece = covariance(part);
+            }
+            else
+            {
+                Vector3D origin = cloud[begin];
+                double sums[9] = {};
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    Vector3D d = cloud[i] - origin;
+                    double products[9] = { d.x, d.y, d.z, d.x * d.x, d.x * d.y, d.x * d.z, d.y * d.y, d.y * d.z, d.z * d.z };
+                    for (std::size_t m = 0; m < 9; ++m)
+                        sums[m] += products[m];
+                }
+                piece = CovarianceAccumulatorD::fromMoments(end - begin, origin, sums);
+            }
+            pieces.push_back(piece);
+        }
+        CovarianceAccumulatorD forward, backward;
+        forward.merge(CovarianceAccumulatorD()); // empty accumulators merge to nothing
+        for (std::size_t c = 0; c < pieces.size(); ++c)
+        {
+            forward.merge(pieces[c]);
+            backward.merge(pieces[pieces.size() - 1 - c]);
+        }
+        // Welford's running mean rounds at every point, which 1e6 from the origin costs its
+        // pieces about 1e-11 of the variance; the batch route stays below 1e-12.
+        for (const CovarianceAccumulatorD& merged : { forward, backward })
+        {
+            CHECK(merged.count == cloud.size());
+            CHECK((merged.mean - center).magnitude() <= 1e-14 * center.magnitude());
+            CHECK(maxDifference(merged.matrix(), exact) <= 1e-10 * variances[0]);
+        }
+        CHECK(CovarianceAccumulatorD::fromMoments(0, center, nullptr).count == 0);
+    }
+
+    struct Section
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    const Section sections[] = {
+        { "sum", &checkSum },
+        { "hnsw", &checkHnsw },
+        { "quantized", &checkQuantized },
+        { "normalize", &checkNormalize },
+        { "kdtree", &checkKdTree },
+        { "cosine", &checkCosine },
+        { "bvh", &checkBvh },
+        { "grid", &checkGrid },
+        { "frames", &checkFrames },
+        { "covariance", &checkCovariance },
+    };
+}
+
+int main(int argc, char** argv)
+{
+    bool ranAny = false;
+    for (const Section& section : sections)
+    {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i)
+            selected = selected || std::strcmp(argv[i], section.name) == 0;
+        if (!selected)
+            continue;
+        int before = failures;
+        section.run();
+        std::printf("%-8s %s\n", section.name, failures == before ? "ok" : "FAILED");
+        ranAny = true;
+    }
+    if (!ranAny)
+    {
+        std::printf("usage: %s [section...]\n", argv[0]);
+        for (const Section& section : sections)
+            std::printf("  %s\n", section.name);
+        return 1;
+    }
+    return failures > 255 ? 255 : failures;
+}